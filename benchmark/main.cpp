@@ -1,4 +1,6 @@
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include <sstream>
@@ -6,7 +8,15 @@
 #include <string_view>
 #include <vector>
 
+#include <vdf_appinfo.hpp>
+#include <vdf_binary.hpp>
+#include <vdf_compact.hpp>
+#include <vdf_diff.hpp>
+#include <vdf_document.hpp>
+#include <vdf_parallel.hpp>
 #include <vdf_parser.hpp>
+#include <vdf_patch.hpp>
+#include <vdf_snapshot.hpp>
 
 #include <benchmark/benchmark.h>
 
@@ -89,9 +99,560 @@ static void BM_ReadGeneratedVDFObject(benchmark::State &state)
     }
 }
 
+static void BM_ReadGeneratedVDFObjectWithHashes(benchmark::State &state)
+{
+    auto vdfString = generate_vdf_structure(VdfGeneratorParams{
+        .attributes = 20, .wordSize = 10, .maxDepth = 5, .vdfObjects = 3});
+    tyti::vdf::Options opt;
+    opt.compute_hashes = state.range(0) != 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            tyti::vdf::read(vdfString.begin(), vdfString.end(), opt).hash);
+    }
+}
+
+static void BM_ReadCorpusWithInvalidFiles(benchmark::State &state)
+{
+    // many small files, the given percentage of them ends with a stray '}'
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < 1'000; ++i)
+    {
+        auto vdfString = generate_vdf_structure(VdfGeneratorParams{
+            .attributes = 4, .wordSize = 10, .maxDepth = 1, .vdfObjects = 1});
+        if (i % 100 < static_cast<size_t>(state.range(0)))
+            vdfString += "}";
+        corpus.push_back(std::move(vdfString));
+    }
+
+    for (auto _ : state)
+    {
+        size_t failed = 0;
+        for (const auto &vdfString : corpus)
+        {
+            std::error_code ec;
+            benchmark::DoNotOptimize(
+                tyti::vdf::read(vdfString.begin(), vdfString.end(), ec));
+            failed += ec ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(failed);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(corpus.size()));
+}
+
+static void BM_ReadUtf16LocalizationFile(benchmark::State &state)
+{
+    // UTF-16LE with BOM and one big Tokens object, like resource/*.txt
+    std::u16string text = u"\uFEFF\"lang\"\n{\n\t\"Language\" \"english\"\n"
+                          u"\t\"Tokens\"\n\t{\n";
+    VdfGeneratorState gen;
+    for (size_t i = 0; i < 100'000; ++i)
+    {
+        const std::string line =
+            std::format("\t\t\"token_{}\" \"{}\"\n", i,
+                        generate_random_string(30, gen));
+        text.append(line.begin(), line.end());
+        if (i % 10 == 0)
+            text += u"\t\t\"umlaut\" \"\u00FC\u20AC\"\n";
+    }
+    text += u"\t}\n}\n";
+    std::string bytes;
+    for (char16_t c : text)
+    {
+        bytes += static_cast<char>(c & 0xFF);
+        bytes += static_cast<char>(c >> 8);
+    }
+
+    for (auto _ : state)
+    {
+        if (state.range(0) == 0)
+        {
+            // decode by hand into a wide string and parse a wobject
+            std::wstring wide;
+            wide.reserve(bytes.size() / 2);
+            for (size_t i = 2; i + 1 < bytes.size(); i += 2)
+                wide += static_cast<wchar_t>(
+                    static_cast<unsigned char>(bytes[i]) |
+                    static_cast<unsigned char>(bytes[i + 1]) << 8);
+            benchmark::DoNotOptimize(
+                tyti::vdf::read(wide.begin(), wide.end()));
+        }
+        else
+        {
+            benchmark::DoNotOptimize(tyti::vdf::read_utf16(
+                bytes.data(), bytes.data() + bytes.size()));
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(bytes.size()));
+}
+
+static void BM_WideToUtf8(benchmark::State &state)
+{
+    // mostly ASCII, like keys and paths
+    std::wstring wide;
+    VdfGeneratorState gen;
+    while (wide.size() < 1'000'000)
+    {
+        const std::string word = generate_random_string(40, gen);
+        wide.append(word.begin(), word.end());
+    }
+
+    for (auto _ : state)
+    {
+        if (state.range(0) == 0)
+        {
+            // the locale dependent conversion, as used before
+            std::mbstate_t mbstate = std::mbstate_t();
+            const wchar_t *src = wide.data();
+            std::string out(std::wcsrtombs(nullptr, &src, 0, &mbstate), '\0');
+            src = wide.data();
+            std::wcsrtombs(&out[0], &src, out.size(), &mbstate);
+            benchmark::DoNotOptimize(out);
+        }
+        else
+        {
+            benchmark::DoNotOptimize(tyti::vdf::to_utf8(wide));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(wide.size()));
+}
+
+static const tyti::vdf::object &generated_vdf_object()
+{
+    static const auto obj = []
+    {
+        auto vdfString = generate_vdf_structure(VdfGeneratorParams{
+            .attributes = 20, .wordSize = 10, .maxDepth = 5, .vdfObjects = 3});
+        return tyti::vdf::read(vdfString.begin(), vdfString.end());
+    }();
+    return obj;
+}
+
+template <typename T> static size_t string_bytes(const std::basic_string<T> &s)
+{
+    // short strings are stored inside of the string object
+    const auto data = reinterpret_cast<const char *>(s.data());
+    const auto self = reinterpret_cast<const char *>(&s);
+    if (data >= self && data < self + sizeof(s))
+        return sizeof(s);
+    return sizeof(s) + (s.capacity() + 1) * sizeof(T);
+}
+
+static size_t string_bytes(const tyti::vdf::wobject &obj)
+{
+    size_t bytes = string_bytes(obj.name);
+    for (const auto &i : obj.attribs)
+        bytes += string_bytes(i.first) + string_bytes(i.second);
+    for (const auto &i : obj.childs)
+        bytes += string_bytes(i.first) + string_bytes(*i.second);
+    return bytes;
+}
+
+static size_t string_bytes(const tyti::vdf::compact_wobject &obj)
+{
+    size_t bytes = string_bytes(obj.utf8_name());
+    for (const auto &i : obj.utf8_attribs())
+        bytes += string_bytes(i.first) + string_bytes(i.second);
+    for (const auto &i : obj.utf8_childs())
+        bytes += string_bytes(i.first) + string_bytes(*i.second);
+    return bytes;
+}
+
+template <typename T, typename charT>
+static void read_wide_tree(benchmark::State &state,
+                           const std::basic_string<charT> &text,
+                           size_t narrow_size)
+{
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        const T root = tyti::vdf::read<T>(text.begin(), text.end());
+        bytes = string_bytes(root);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(narrow_size));
+    state.counters["string_bytes"] = static_cast<double>(bytes);
+}
+
+static void BM_ReadGeneratedWideObject(benchmark::State &state)
+{
+    const auto narrow = generate_vdf_structure(VdfGeneratorParams{
+        .attributes = 20, .wordSize = 10, .maxDepth = 5, .vdfObjects = 3});
+    const std::wstring wide = tyti::vdf::to_wstring(narrow);
+
+    // 0: wobject, 1: compact_wobject from wide text, 2: from UTF-8 text
+    if (state.range(0) == 0)
+        read_wide_tree<tyti::vdf::wobject>(state, wide, narrow.size());
+    else if (state.range(0) == 1)
+        read_wide_tree<tyti::vdf::compact_wobject>(state, wide, narrow.size());
+    else
+        read_wide_tree<tyti::vdf::compact_wobject>(state, narrow,
+                                                    narrow.size());
+}
+
+static void BM_WriteGeneratedVDFObject(benchmark::State &state)
+{
+    const auto &obj = generated_vdf_object();
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write(buffer, obj);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_WriteEscapeDenseVDFObject(benchmark::State &state)
+{
+    // every other character has to be escaped
+    tyti::vdf::object obj;
+    obj.name = "root";
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::string value;
+        for (int j = 0; j < 500; ++j)
+            value += j % 2 ? "a\\" : "b\"";
+        obj.attribs["key" + std::to_string(i)] = std::move(value);
+    }
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write(buffer, obj);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_WriteDeepChainVDFObject(benchmark::State &state)
+{
+    // chain of nested objects; compact output, as the indentation of the
+    // pretty output grows quadratically with the depth
+    const auto depth = static_cast<size_t>(state.range(0));
+    auto root = std::make_shared<tyti::vdf::object>();
+    root->name = "level0";
+    tyti::vdf::object *cur = root.get();
+    for (size_t i = 1; i < depth; ++i)
+    {
+        auto child = std::make_shared<tyti::vdf::object>();
+        child->name = std::format("level{}", i);
+        child->attribs["depth"] = std::to_string(i);
+        cur->childs.emplace(child->name, child);
+        cur = child.get();
+    }
+    tyti::vdf::WriteOptions opts;
+    opts.compact = true;
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write(buffer, *root, opts);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+
+    // the destructors would recurse through the whole chain
+    while (!root->childs.empty())
+        root = root->childs.begin()->second;
+}
+
+static void BM_WriteCompactGeneratedVDFObject(benchmark::State &state)
+{
+    const auto &obj = generated_vdf_object();
+    tyti::vdf::WriteOptions opts;
+    opts.compact = true;
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write(buffer, obj, opts);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_ReadValidatedUtf8(benchmark::State &state)
+{
+    std::string buffer;
+    tyti::vdf::write(buffer, generated_vdf_object());
+
+    // 0: no validation, 1: separate pass before parsing, 2: validate_utf8
+    tyti::vdf::Options opt;
+    opt.validate_utf8 = state.range(0) == 2;
+    for (auto _ : state)
+    {
+        if (state.range(0) == 1 &&
+            tyti::vdf::detail::find_invalid_utf8(buffer.data(),
+                                                 buffer.size()) !=
+                buffer.size())
+            state.SkipWithError("invalid UTF-8");
+        std::ignore = tyti::vdf::read(buffer.begin(), buffer.end(), opt);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_ReadCompactGeneratedVDFObject(benchmark::State &state)
+{
+    tyti::vdf::WriteOptions opts;
+    opts.compact = true;
+    std::string buffer;
+    tyti::vdf::write(buffer, generated_vdf_object(), opts);
+
+    for (auto _ : state)
+    {
+        std::ignore = tyti::vdf::read(buffer.begin(), buffer.end());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_WriteParallelGeneratedVDFObject(benchmark::State &state)
+{
+    const auto &obj = generated_vdf_object();
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write_parallel(buffer, obj, {},
+                                  static_cast<unsigned>(state.range(0)));
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_WriteGeneratedVDFObjectToStream(benchmark::State &state)
+{
+    const auto &obj = generated_vdf_object();
+
+    size_t size = 0;
+    for (auto _ : state)
+    {
+        std::ostringstream stream;
+        tyti::vdf::write(stream, obj);
+        size = static_cast<size_t>(stream.tellp());
+        benchmark::DoNotOptimize(size);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(size));
+}
+
+static void BM_PatchValueGeneratedVDF(benchmark::State &state)
+{
+    // the cost depends on the distance to the key, not on the file size
+    auto vdfString = generate_vdf_structure(VdfGeneratorParams{
+        .attributes = 20, .wordSize = 10, .maxDepth = 5, .vdfObjects = 3});
+    const std::vector<std::string> path =
+        state.range(0) == 0
+            ? std::vector<std::string>{"vdf_object_0_0", "item_0"}
+            : std::vector<std::string>{"vdf_object_0_0", "vdf_object_1_4",
+                                       "item_19"};
+
+    for (auto _ : state)
+    {
+        // same length as the generated words, so the buffer does not move
+        benchmark::DoNotOptimize(
+            tyti::vdf::patch_value(vdfString, path, "0123456789"));
+    }
+}
+
+static void BM_DocumentEditGeneratedVDF(benchmark::State &state)
+{
+    // edits a value in a leaf object, the latency should not depend on the
+    // size of the document
+    tyti::vdf::document doc(generate_vdf_structure(
+        VdfGeneratorParams{.attributes = 20,
+                           .wordSize = 10,
+                           .maxDepth = static_cast<size_t>(state.range(0)),
+                           .vdfObjects = 3}));
+    const size_t offset = doc.text().rfind("\"item_0\" \"") + 10;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(doc.edit(offset, 10, "0123456789"));
+    }
+    state.counters["document_bytes"] =
+        static_cast<double>(doc.text().size());
+}
+
+static void BM_DiffGeneratedVDFObject(benchmark::State &state)
+{
+    // one changed value in a leaf. With hashes, only the objects along its
+    // path are compared
+    tyti::vdf::Options opt;
+    opt.compute_hashes = state.range(0) != 0;
+    auto vdfString = generate_vdf_structure(VdfGeneratorParams{
+        .attributes = 20, .wordSize = 10, .maxDepth = 5, .vdfObjects = 3});
+    const auto before =
+        tyti::vdf::read(vdfString.begin(), vdfString.end(), opt);
+    vdfString.replace(vdfString.rfind("\"item_0\" \"") + 10, 10,
+                      "0123456789");
+    const auto after =
+        tyti::vdf::read(vdfString.begin(), vdfString.end(), opt);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(tyti::vdf::diff(before, after));
+    }
+}
+
+static void BM_WriteBinaryGeneratedVDFObject(benchmark::State &state)
+{
+    const auto &obj = generated_vdf_object();
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        tyti::vdf::write_binary(buffer, obj);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_ReadBinaryGeneratedVDFObject(benchmark::State &state)
+{
+    std::string buffer;
+    tyti::vdf::write_binary(buffer, generated_vdf_object());
+
+    for (auto _ : state)
+    {
+        std::ignore = tyti::vdf::read_binary(buffer.data(),
+                                             buffer.data() + buffer.size());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(buffer.size()));
+}
+
+static void BM_AppinfoLookup(benchmark::State &state)
+{
+    // appinfo.vdf v28 with one small record per app
+    const uint32_t apps = 100'000;
+    std::string data;
+    tyti::vdf::detail::store_le32(data, tyti::vdf::detail::appinfo_magic_v28);
+    tyti::vdf::detail::store_le32(data, 1);
+    for (uint32_t id = 1; id <= apps; ++id)
+    {
+        tyti::vdf::object app;
+        app.name = "appinfo";
+        app.attribs["appid"] = std::to_string(id);
+        app.attribs["name"] = std::format("App {}", id);
+        std::string payload;
+        tyti::vdf::write_binary(payload, app);
+
+        tyti::vdf::detail::store_le32(data, id);
+        tyti::vdf::detail::store_le32(data,
+                                      static_cast<uint32_t>(60 + payload.size()));
+        data.append(60, '\0');
+        data += payload;
+    }
+    tyti::vdf::detail::store_le32(data, 0);
+
+    const auto path =
+        std::filesystem::temp_directory_path() / "vdf_benchmark_appinfo.vdf";
+    std::ofstream(path, std::ios::binary)
+        .write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    tyti::vdf::appinfo_reader appinfo(path.string());
+    std::mt19937 rng{1234};
+    std::uniform_int_distribution<uint32_t> app_id(1, apps);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(appinfo.read(app_id(rng)));
+    }
+    std::filesystem::remove(path);
+}
+
+static void BM_OpenSnapshotGeneratedVDFObject(benchmark::State &state)
+{
+    const auto path =
+        std::filesystem::temp_directory_path() / "vdf_benchmark_snapshot.bin";
+    tyti::vdf::save_snapshot(generated_vdf_object(), path.string());
+
+    for (auto _ : state)
+    {
+        const auto snap = tyti::vdf::open_snapshot(path.string());
+        benchmark::DoNotOptimize(
+            snap.root().child("vdf_object_1_3").attribute("item_7"));
+    }
+    std::filesystem::remove(path);
+}
+
 // Register the benchmark
 BENCHMARK(BM_ReadGeneratedVDFObject)
     ->Unit(benchmark::kMillisecond)
     ->Iterations(5'000);
+BENCHMARK(BM_ReadGeneratedVDFObjectWithHashes)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK(BM_ReadCorpusWithInvalidFiles)
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(0)
+    ->Arg(50)
+    ->Arg(90);
+BENCHMARK(BM_ReadUtf16LocalizationFile)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK(BM_WideToUtf8)->Unit(benchmark::kMicrosecond)->Arg(0)->Arg(1);
+BENCHMARK(BM_ReadGeneratedWideObject)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2);
+BENCHMARK(BM_WriteGeneratedVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteGeneratedVDFObjectToStream)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteParallelGeneratedVDFObject)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8);
+BENCHMARK(BM_WriteEscapeDenseVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WriteDeepChainVDFObject)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1'000)
+    ->Arg(100'000)
+    ->Arg(1'000'000);
+BENCHMARK(BM_WriteCompactGeneratedVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadCompactGeneratedVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadValidatedUtf8)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2);
+BENCHMARK(BM_PatchValueGeneratedVDF)
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK(BM_DocumentEditGeneratedVDF)
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(4)
+    ->Arg(5);
+BENCHMARK(BM_DiffGeneratedVDFObject)
+    ->Unit(benchmark::kMicrosecond)
+    ->Arg(0)
+    ->Arg(1);
+BENCHMARK(BM_WriteBinaryGeneratedVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadBinaryGeneratedVDFObject)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AppinfoLookup)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_OpenSnapshotGeneratedVDFObject)->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_MAIN();
\ No newline at end of file
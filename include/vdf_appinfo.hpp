@@ -0,0 +1,363 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_APPINFO_H__
+#define __TYTI_STEAM_VDF_APPINFO_H__
+
+#include "vdf_binary.hpp"
+#include "vdf_mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/// metadata of a single app stored in appinfo.vdf
+struct appinfo_record
+{
+    std::uint32_t app_id = 0;
+    std::uint32_t info_state = 0;
+    std::uint32_t last_updated = 0;
+    std::uint32_t change_number = 0;
+    std::uint64_t pics_token = 0;
+    /// position and size of the binary KeyValues payload in the file
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+};
+
+namespace detail
+{
+enum : std::uint32_t
+{
+    appinfo_magic_v27 = 0x07564427,
+    appinfo_magic_v28 = 0x07564428,
+    appinfo_magic_v29 = 0x07564429
+};
+
+// layout of a persisted appinfo index
+const char appinfo_index_magic[8] = {'V', 'D', 'F', 'A', 'P', 'I', 'D', 'X'};
+enum : std::uint32_t
+{
+    appinfo_index_version = 1,
+    appinfo_index_header_size = 48,
+    appinfo_index_record_size = 40
+};
+} // namespace detail
+
+/** \brief Random access reader for Steam's appinfo.vdf.
+The file is mapped into memory and only the record headers are scanned to
+build an index of app id -> payload. The binary KeyValues of an app are parsed
+on request, so looking up a few apps does not require parsing the whole file.
+*/
+class appinfo_reader
+{
+  public:
+    /** \brief opens the appinfo.vdf file and builds the index.
+    @param path         path of appinfo.vdf
+    @param index_path   optional path of a persisted index. If it matches the
+                        current file, it is used instead of scanning the file.
+                        Otherwise the index is build and saved to this path.
+
+    can throw:
+        - "std::system_error" if the file cannot be opened or mapped
+        - "std::runtime_error" if the file is not a supported appinfo.vdf
+    */
+    explicit appinfo_reader(const std::string &path,
+                            const std::string &index_path = std::string())
+        : file_(path)
+    {
+        read_header();
+        if (!index_path.empty() && load_index(index_path))
+        {
+            loaded_index_ = true;
+            return;
+        }
+        build_index();
+        if (!index_path.empty())
+        {
+            try
+            {
+                save_index(index_path);
+            }
+            catch (std::exception &)
+            {
+                // the index is just a cache, failing to store it is not fatal
+            }
+        }
+    }
+
+    /// appinfo format version (27, 28 or 29)
+    std::uint32_t version() const noexcept { return version_; }
+    std::uint32_t universe() const noexcept { return universe_; }
+
+    /// number of apps in the file
+    std::size_t size() const noexcept { return records_.size(); }
+
+    /// all records, sorted by app id
+    const std::vector<appinfo_record> &records() const noexcept
+    {
+        return records_;
+    }
+
+    /// true, if the index was loaded from the index file instead of scanning
+    bool loaded_index() const noexcept { return loaded_index_; }
+
+    /// returns the record of the given app or nullptr if it does not exist
+    const appinfo_record *find(std::uint32_t app_id) const noexcept
+    {
+        const auto it = std::lower_bound(
+            records_.begin(), records_.end(), app_id,
+            [](const appinfo_record &r, std::uint32_t id)
+            { return r.app_id < id; });
+        if (it == records_.end() || it->app_id != app_id)
+            return nullptr;
+        return &*it;
+    }
+
+    bool contains(std::uint32_t app_id) const noexcept
+    {
+        return find(app_id) != nullptr;
+    }
+
+    /** \brief parses the KeyValues of the given app.
+    can throw:
+        - "std::out_of_range" if the app does not exist
+        - "std::runtime_error" if the payload is malformatted
+    */
+    template <typename OutputT = object> OutputT read(std::uint32_t app_id) const
+    {
+        const appinfo_record *record = find(app_id);
+        if (!record)
+            throw std::out_of_range{"app " + std::to_string(app_id) +
+                                    " is not part of appinfo"};
+        return read<OutputT>(*record);
+    }
+
+    /// parses the KeyValues of the given record
+    template <typename OutputT = object>
+    OutputT read(const appinfo_record &record) const
+    {
+        const char *first = file_.data() + record.offset;
+        return detail::read_binary_object<OutputT>(
+            first, first + record.size, version_ >= 29 ? &key_table_ : nullptr);
+    }
+
+    /// stores the index, so it can be passed as index_path on the next open.
+    /// throws "std::runtime_error" if the file cannot be written
+    void save_index(const std::string &index_path) const
+    {
+        std::string buffer;
+        buffer.reserve(detail::appinfo_index_header_size +
+                       records_.size() * detail::appinfo_index_record_size);
+        buffer.append(detail::appinfo_index_magic, 8);
+        detail::store_le32(buffer, detail::appinfo_index_version);
+        detail::store_le32(buffer, magic_);
+        detail::store_le64(buffer, file_.identity().size);
+        detail::store_le64(buffer, static_cast<std::uint64_t>(
+                                       file_.identity().mtime_ns));
+        detail::store_le64(buffer, file_.identity().inode);
+        detail::store_le64(buffer, records_.size());
+        for (const auto &r : records_)
+        {
+            detail::store_le32(buffer, r.app_id);
+            detail::store_le32(buffer, r.info_state);
+            detail::store_le32(buffer, r.last_updated);
+            detail::store_le32(buffer, r.change_number);
+            detail::store_le64(buffer, r.pics_token);
+            detail::store_le64(buffer, r.offset);
+            detail::store_le64(buffer, r.size);
+        }
+
+        // write a temporary file and move it into place, so readers never
+        // see a partially written index
+        const std::string tmp = detail::temp_file_name(index_path);
+        bool written;
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(buffer.data(),
+                      static_cast<std::streamsize>(buffer.size()));
+            out.close();
+            written = !out.fail();
+        }
+        if (!written || !detail::replace_file(tmp, index_path))
+        {
+            std::remove(tmp.c_str());
+            throw std::runtime_error{"cannot write appinfo index " +
+                                     index_path};
+        }
+    }
+
+  private:
+    void read_header()
+    {
+        const char *data = file_.data();
+        if (file_.size() < 8)
+            throw std::runtime_error{"appinfo header is incomplete"};
+        magic_ = detail::load_le32(data);
+        universe_ = detail::load_le32(data + 4);
+        switch (magic_)
+        {
+        case detail::appinfo_magic_v27:
+            version_ = 27;
+            break;
+        case detail::appinfo_magic_v28:
+            version_ = 28;
+            break;
+        case detail::appinfo_magic_v29:
+            version_ = 29;
+            break;
+        default:
+            throw std::runtime_error{"unsupported appinfo version"};
+        }
+        records_begin_ = 8;
+        records_end_ = file_.size();
+        if (version_ >= 29)
+        {
+            if (file_.size() < 16)
+                throw std::runtime_error{"appinfo header is incomplete"};
+            const std::uint64_t table = detail::load_le64(data + 8);
+            if (table > file_.size())
+                throw std::runtime_error{"appinfo string table out of range"};
+            records_begin_ = 16;
+            records_end_ = static_cast<std::size_t>(table);
+            read_key_table(data + table, file_.end());
+        }
+    }
+
+    void read_key_table(const char *cur, const char *last)
+    {
+        if (last - cur < 4)
+            throw std::runtime_error{"appinfo string table is incomplete"};
+        const std::uint32_t count = detail::load_le32(cur);
+        cur += 4;
+        // every string needs at least its terminator
+        if (count > static_cast<std::size_t>(last - cur))
+            throw std::runtime_error{"appinfo string table is incomplete"};
+        key_table_.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+            key_table_.push_back(detail::read_binary_cstring(cur, last));
+    }
+
+    void build_index()
+    {
+        // record: app id, size, info state, last updated, pics token,
+        // sha1 (20 bytes), change number, [sha1 of binary data (20 bytes)]
+        const std::size_t fixed = version_ >= 28 ? 60 : 40;
+        const char *data = file_.data();
+        std::size_t pos = records_begin_;
+        while (records_end_ - pos >= 4)
+        {
+            const char *r = data + pos;
+            appinfo_record record;
+            record.app_id = detail::load_le32(r);
+            if (record.app_id == 0)
+                break;
+            if (records_end_ - pos < 8)
+                throw std::runtime_error{"appinfo record is incomplete"};
+            const std::uint32_t size = detail::load_le32(r + 4);
+            if (size < fixed || records_end_ - pos - 8 < size)
+                throw std::runtime_error{"appinfo record is incomplete"};
+            record.info_state = detail::load_le32(r + 8);
+            record.last_updated = detail::load_le32(r + 12);
+            record.pics_token = detail::load_le64(r + 16);
+            record.change_number = detail::load_le32(r + 44);
+            record.offset = pos + 8 + fixed;
+            record.size = size - fixed;
+            records_.push_back(record);
+            pos += 8 + size;
+        }
+        std::stable_sort(records_.begin(), records_.end(),
+                         [](const appinfo_record &a, const appinfo_record &b)
+                         { return a.app_id < b.app_id; });
+    }
+
+    bool load_index(const std::string &index_path)
+    {
+        detail::mapped_file index;
+        try
+        {
+            index = detail::mapped_file(index_path);
+        }
+        catch (std::system_error &)
+        {
+            return false;
+        }
+        const char *data = index.data();
+        if (index.size() < detail::appinfo_index_header_size ||
+            !std::equal(data, data + 8, detail::appinfo_index_magic) ||
+            detail::load_le32(data + 8) != detail::appinfo_index_version ||
+            detail::load_le32(data + 12) != magic_ ||
+            detail::load_le64(data + 16) != file_.identity().size ||
+            detail::load_le64(data + 24) !=
+                static_cast<std::uint64_t>(file_.identity().mtime_ns) ||
+            detail::load_le64(data + 32) != file_.identity().inode)
+            return false;
+        const std::uint64_t count = detail::load_le64(data + 40);
+        if (count > (index.size() - detail::appinfo_index_header_size) /
+                        detail::appinfo_index_record_size ||
+            index.size() != detail::appinfo_index_header_size +
+                                count * detail::appinfo_index_record_size)
+            return false;
+
+        std::vector<appinfo_record> records(static_cast<std::size_t>(count));
+        const char *r = data + detail::appinfo_index_header_size;
+        for (auto &record : records)
+        {
+            record.app_id = detail::load_le32(r);
+            record.info_state = detail::load_le32(r + 4);
+            record.last_updated = detail::load_le32(r + 8);
+            record.change_number = detail::load_le32(r + 12);
+            record.pics_token = detail::load_le64(r + 16);
+            record.offset = detail::load_le64(r + 24);
+            record.size = detail::load_le64(r + 32);
+            if (record.offset > records_end_ ||
+                record.size > records_end_ - record.offset)
+                return false;
+            r += detail::appinfo_index_record_size;
+        }
+        records_ = std::move(records);
+        return true;
+    }
+
+    detail::mapped_file file_;
+    std::uint32_t magic_ = 0;
+    std::uint32_t version_ = 0;
+    std::uint32_t universe_ = 0;
+    std::size_t records_begin_ = 0;
+    std::size_t records_end_ = 0;
+    std::vector<std::string> key_table_;
+    std::vector<appinfo_record> records_;
+    bool loaded_index_ = false;
+};
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_APPINFO_H__
@@ -0,0 +1,631 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_BINARY_H__
+#define __TYTI_STEAM_VDF_BINARY_H__
+
+#include "vdf_parser.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stack>
+#include <string>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/// type tags of Valve's binary KeyValues format
+/// (e.g. shortcuts.vdf, appinfo.vdf, packageinfo.vdf)
+enum class binary_type : unsigned char
+{
+    object = 0x00,
+    string = 0x01,
+    int32 = 0x02,
+    float32 = 0x03,
+    pointer = 0x04,
+    wstring = 0x05,
+    color = 0x06,
+    uint64 = 0x07,
+    end = 0x08,
+    int64 = 0x0A,
+    end_alt = 0x0B
+};
+
+/// options for writing binary KeyValues
+struct BinaryWriteOptions
+{
+    /// binary type of attribute values, selected by the attribute key.
+    /// Attributes without a hint are written as strings.
+    std::unordered_map<std::string, binary_type> type_hints;
+};
+
+namespace detail
+{
+///////////////////////////////////////////////////////////////////////////
+//  Binary helper functions
+///////////////////////////////////////////////////////////////////////////
+
+// values in the binary format are always stored as little endian
+inline std::uint32_t load_le32(const char *p) noexcept
+{
+    unsigned char b[4];
+    std::memcpy(b, p, 4);
+    return static_cast<std::uint32_t>(b[0]) |
+           static_cast<std::uint32_t>(b[1]) << 8 |
+           static_cast<std::uint32_t>(b[2]) << 16 |
+           static_cast<std::uint32_t>(b[3]) << 24;
+}
+
+inline std::uint64_t load_le64(const char *p) noexcept
+{
+    return static_cast<std::uint64_t>(load_le32(p)) |
+           static_cast<std::uint64_t>(load_le32(p + 4)) << 32;
+}
+
+inline void store_le32(std::string &out, std::uint32_t v)
+{
+    const char b[4] = {static_cast<char>(v & 0xFF),
+                       static_cast<char>((v >> 8) & 0xFF),
+                       static_cast<char>((v >> 16) & 0xFF),
+                       static_cast<char>((v >> 24) & 0xFF)};
+    out.append(b, 4);
+}
+
+inline void store_le64(std::string &out, std::uint64_t v)
+{
+    store_le32(out, static_cast<std::uint32_t>(v & 0xFFFFFFFF));
+    store_le32(out, static_cast<std::uint32_t>(v >> 32));
+}
+
+/// parses a decimal integer into its sign and magnitude. Returns false, if the
+/// string is not a number or does not fit into 64 bits
+inline bool parse_integer(const std::string &s, std::uint64_t &magnitude,
+                          bool &negative)
+{
+    auto iter = s.begin();
+    negative = iter != s.end() && *iter == '-';
+    if (negative || (iter != s.end() && *iter == '+'))
+        ++iter;
+    if (iter == s.end())
+        return false;
+    magnitude = 0;
+    for (; iter != s.end(); ++iter)
+    {
+        if (*iter < '0' || *iter > '9')
+            return false;
+        const auto digit = static_cast<std::uint64_t>(*iter - '0');
+        if (magnitude > (UINT64_MAX - digit) / 10)
+            return false;
+        magnitude = magnitude * 10 + digit;
+    }
+    return true;
+}
+
+/// parses the strings float_to_string() produces, including "inf", "-inf",
+/// "nan" and "-nan" for non-finite values. The payload of NaNs is not kept
+inline bool string_to_float(const std::string &value, float &f)
+{
+    if (value == "inf" || value == "-inf")
+    {
+        f = std::numeric_limits<float>::infinity();
+        f = value[0] == '-' ? -f : f;
+        return true;
+    }
+    if (value == "nan" || value == "-nan")
+    {
+        f = std::copysign(std::numeric_limits<float>::quiet_NaN(),
+                          value[0] == '-' ? -1.f : 1.f);
+        return true;
+    }
+    std::istringstream in(value);
+    in.imbue(std::locale::classic());
+    return (in >> f) && in.peek() == std::char_traits<char>::eof();
+}
+
+/// appends the value in its binary representation of the given type
+inline void append_binary_value(std::string &out, binary_type type,
+                                const std::string &value)
+{
+    auto invalid = [&value]()
+    {
+        return std::runtime_error{"value \"" + value +
+                                  "\" does not match its binary type"};
+    };
+    // returns the two's complement of the value, if it is in
+    // [-max_negative, max_positive]
+    auto integer = [&value, &invalid](std::uint64_t max_negative,
+                                      std::uint64_t max_positive)
+    {
+        std::uint64_t magnitude = 0;
+        bool negative = false;
+        if (!parse_integer(value, magnitude, negative) ||
+            magnitude > (negative ? max_negative : max_positive))
+            throw invalid();
+        return negative ? ~magnitude + 1 : magnitude;
+    };
+    switch (type)
+    {
+    case binary_type::string:
+        if (value.find('\0') != value.npos)
+            throw invalid();
+        out += value;
+        out += '\0';
+        break;
+    case binary_type::int32:
+        store_le32(out, static_cast<std::uint32_t>(
+                            integer(UINT64_C(0x80000000), INT32_MAX)));
+        break;
+    case binary_type::pointer:
+    case binary_type::color:
+        // colors and pointers are read as signed but are often given unsigned
+        store_le32(out, static_cast<std::uint32_t>(
+                            integer(UINT64_C(0x80000000), UINT32_MAX)));
+        break;
+    case binary_type::uint64:
+        store_le64(out, integer(0, UINT64_MAX));
+        break;
+    case binary_type::int64:
+        store_le64(out, integer(UINT64_C(0x8000000000000000), INT64_MAX));
+        break;
+    case binary_type::float32:
+    {
+        float f = 0.f;
+        if (!string_to_float(value, f))
+            throw invalid();
+        std::uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        store_le32(out, bits);
+        break;
+    }
+    case binary_type::wstring:
+    {
+        // invalid sequences become U+FFFD
+        std::u16string units;
+        utf8_to_units(value.data(), value.size(), units);
+        for (const char16_t u : units)
+        {
+            out += static_cast<char>(u & 0xFF);
+            out += static_cast<char>(u >> 8);
+        }
+        out.append(2, '\0');
+        break;
+    }
+    default:
+        throw std::runtime_error{"type hint is not a value type"};
+    }
+}
+
+inline void append_binary_key(std::string &out, binary_type type,
+                              const std::string &key)
+{
+    if (key.find('\0') != key.npos)
+        throw std::runtime_error{"key contains a null character"};
+    out += static_cast<char>(type);
+    out += key;
+    out += '\0';
+}
+
+template <typename T>
+void write_binary_object(std::string &out, const T &r,
+                         const BinaryWriteOptions &opts)
+{
+    // explicit stack, so deep trees cannot overflow the call stack
+    typedef decltype(r.childs.begin()) child_iterator;
+    struct level
+    {
+        const T *obj;
+        child_iterator next_child;
+    };
+    std::stack<level> lvls;
+
+    auto open = [&](const T &obj)
+    {
+        append_binary_key(out, binary_type::object, obj.name);
+        for (const auto &i : obj.attribs)
+        {
+            binary_type type = binary_type::string;
+            if (!opts.type_hints.empty())
+            {
+                const auto hint = opts.type_hints.find(i.first);
+                if (hint != opts.type_hints.end())
+                    type = hint->second;
+            }
+            append_binary_key(out, type, i.first);
+            append_binary_value(out, type, i.second);
+        }
+        lvls.push(level{&obj, obj.childs.begin()});
+    };
+
+    open(r);
+    while (!lvls.empty())
+    {
+        level &cur = lvls.top();
+        if (cur.next_child != cur.obj->childs.end())
+        {
+            const auto &child = (cur.next_child++)->second;
+            if (child)
+                open(*child);
+            continue;
+        }
+        lvls.pop();
+        out += static_cast<char>(binary_type::end);
+    }
+}
+
+/// shortest locale independent representation which reads back to the same
+/// float. Non-finite values are "inf", "-inf", "nan" and "-nan" on every
+/// platform
+inline std::string float_to_string(float f)
+{
+    if (std::isnan(f))
+        return std::signbit(f) ? "-nan" : "nan";
+    if (std::isinf(f))
+        return f < 0 ? "-inf" : "inf";
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    for (int precision = 6; precision < 9; ++precision)
+    {
+        out.str(std::string());
+        out << std::setprecision(precision) << f;
+        std::istringstream in(out.str());
+        in.imbue(std::locale::classic());
+        float back = 0.f;
+        if ((in >> back) && back == f)
+            return out.str();
+    }
+    out.str(std::string());
+    out << std::setprecision(9) << f;
+    return out.str();
+}
+
+/// reads a null terminated string starting at cur and moves cur behind the
+/// terminator
+inline std::string read_binary_cstring(const char *&cur, const char *last)
+{
+    const void *term = std::memchr(cur, '\0', static_cast<size_t>(last - cur));
+    if (!term)
+        throw std::runtime_error{"string is not terminated"};
+    const char *end = static_cast<const char *>(term);
+    std::string str(cur, end);
+    cur = end + 1;
+    return str;
+}
+
+/** \brief Read binary KeyValues defined by the range [cur, last).
+Parsing stops at the end of the range or at an end marker on root level.
+@param cur      begin of the data. Points behind the last consumed byte
+                afterwards.
+@param last     end of the data
+@param key_table if given, keys are stored as 32 bit indices into this table
+                instead of null terminated strings (appinfo.vdf since v29)
+
+can thow:
+        - "std::runtime_error" if a parsing error occured
+        - "std::bad_alloc" if not enough memory coup be allocated
+*/
+template <typename OutputT>
+std::vector<std::unique_ptr<OutputT>>
+read_binary_internal(const char *&cur, const char *last,
+                     const std::vector<std::string> *key_table = nullptr)
+{
+    static_assert(std::is_default_constructible<OutputT>::value,
+                  "Output Type must be default constructible (provide "
+                  "constructor without arguments)");
+    static_assert(std::is_move_constructible<OutputT>::value,
+                  "Output Type must be move constructible");
+
+    auto require = [&cur, last](size_t n)
+    {
+        if (static_cast<size_t>(last - cur) < n)
+            throw std::runtime_error{"unexpected end of binary data"};
+    };
+
+    std::unique_ptr<OutputT> curObj = nullptr;
+    std::vector<std::unique_ptr<OutputT>> roots;
+    std::stack<std::unique_ptr<OutputT>> lvls;
+
+    while (cur != last)
+    {
+        const auto type = static_cast<binary_type>(*cur++);
+        if (type == binary_type::end || type == binary_type::end_alt)
+        {
+            // end marker on root level terminates the data
+            if (!curObj)
+                break;
+            if (!lvls.empty())
+            {
+                std::unique_ptr<OutputT> prev{std::move(lvls.top())};
+                lvls.pop();
+                prev->add_child(std::move(curObj));
+                curObj = std::move(prev);
+            }
+            else
+            {
+                roots.push_back(std::move(curObj));
+                curObj.reset();
+            }
+            continue;
+        }
+
+        std::string key;
+        if (key_table)
+        {
+            require(4);
+            const std::uint32_t index = load_le32(cur);
+            if (index >= key_table->size())
+                throw std::runtime_error{"key index out of range"};
+            key = (*key_table)[index];
+            cur += 4;
+        }
+        else
+            key = read_binary_cstring(cur, last);
+        std::string value;
+        switch (type)
+        {
+        case binary_type::object:
+            if (curObj)
+                lvls.push(std::move(curObj));
+            curObj = std::make_unique<OutputT>();
+            curObj->set_name(std::move(key));
+            continue;
+        case binary_type::string:
+            value = read_binary_cstring(cur, last);
+            break;
+        case binary_type::int32:
+        case binary_type::pointer:
+        case binary_type::color:
+            require(4);
+            value = std::to_string(static_cast<std::int32_t>(load_le32(cur)));
+            cur += 4;
+            break;
+        case binary_type::float32:
+        {
+            require(4);
+            const std::uint32_t bits = load_le32(cur);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            value = float_to_string(f);
+            cur += 4;
+            break;
+        }
+        case binary_type::uint64:
+            require(8);
+            value = std::to_string(load_le64(cur));
+            cur += 8;
+            break;
+        case binary_type::int64:
+            require(8);
+            value = std::to_string(static_cast<std::int64_t>(load_le64(cur)));
+            cur += 8;
+            break;
+        case binary_type::wstring:
+        {
+            const char *end = cur;
+            while (last - end >= 2 && (end[0] != '\0' || end[1] != '\0'))
+                end += 2;
+            if (last - end < 2)
+                throw std::runtime_error{"string is not terminated"};
+            // unpaired surrogates become U+FFFD
+            value.clear();
+            utf16_to_utf8(reinterpret_cast<const unsigned char *>(cur),
+                          static_cast<size_t>(end - cur) / 2, false, value);
+            cur = end + 2;
+            break;
+        }
+        default:
+            throw std::runtime_error{"unknown binary type"};
+        }
+
+        if (!curObj)
+            throw std::runtime_error{"unexpected key without object"};
+        curObj->add_attribute(std::move(key), std::move(value));
+    }
+    if (curObj != nullptr || !lvls.empty())
+    {
+        throw std::runtime_error{"object is not closed with an end marker"};
+    }
+    return roots;
+}
+
+/// reads the binary KeyValues in [first, last) and combines the roots like
+/// the text parser does
+template <typename OutputT>
+OutputT read_binary_object(const char *first, const char *last,
+                           const std::vector<std::string> *key_table = nullptr)
+{
+    auto roots = read_binary_internal<OutputT>(first, last, key_table);
+
+    OutputT result;
+    if (roots.size() > 1)
+    {
+        for (auto &i : roots)
+            result.add_child(std::move(i));
+    }
+    else if (roots.size() == 1)
+        result = std::move(*roots[0]);
+
+    return result;
+}
+
+} // namespace detail
+
+/** \brief Read binary KeyValues defined by the range [first, last).
+All values are stored in their textual representation, so the result is the
+same as reading the equivalent text file.
+@param first begin of the data
+@param last end of the data
+
+can thow:
+        - "std::runtime_error" if a parsing error occured
+        - "std::bad_alloc" if not enough memory coup be allocated
+*/
+template <typename OutputT>
+OutputT read_binary(const char *first, const char *last)
+{
+    return detail::read_binary_object<OutputT>(first, last);
+}
+
+/** \brief Read binary KeyValues defined by the range [first, last).
+@param first begin of the data
+@param last end of the data
+@param ec output bool. 0 if ok, otherwise, holds an system error code
+
+Possible error codes:
+std::errc::protocol_error: data is mailformatted
+std::errc::not_enough_memory: not enough space
+std::errc::invalid_argument: unknown error
+*/
+template <typename OutputT>
+OutputT read_binary(const char *first, const char *last,
+                    std::error_code &ec) noexcept
+{
+    ec.clear();
+    OutputT r{};
+    try
+    {
+        r = read_binary<OutputT>(first, last);
+    }
+    catch (std::runtime_error &)
+    {
+        ec = std::make_error_code(std::errc::protocol_error);
+    }
+    catch (std::bad_alloc &)
+    {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+    }
+    catch (...)
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+    }
+    return r;
+}
+
+/** \brief Read binary KeyValues defined by the range [first, last).
+@param first begin of the data
+@param last end of the data
+@param ok output bool. true, if parser successed, false, if parser failed
+*/
+template <typename OutputT>
+OutputT read_binary(const char *first, const char *last, bool *ok) noexcept
+{
+    std::error_code ec;
+    auto r = read_binary<OutputT>(first, last, ec);
+    if (ok)
+        *ok = !ec;
+    return r;
+}
+
+inline object read_binary(const char *first, const char *last)
+{
+    return read_binary<object>(first, last);
+}
+
+inline object read_binary(const char *first, const char *last,
+                          std::error_code &ec) noexcept
+{
+    return read_binary<object>(first, last, ec);
+}
+
+inline object read_binary(const char *first, const char *last,
+                          bool *ok) noexcept
+{
+    return read_binary<object>(first, last, ok);
+}
+
+/** \brief Loads a stream (e.g. filestream opened with std::ios::binary) into
+   the memory and parses the binary KeyValues.
+   throws "std::bad_alloc" if file buffer could not be allocated
+   throws "std::runtime_error" if a parsing error occured
+*/
+template <typename OutputT, typename iStreamT>
+OutputT read_binary(iStreamT &inStream)
+{
+    const std::string str = detail::read_file(inStream);
+    return read_binary<OutputT>(str.data(), str.data() + str.size());
+}
+
+template <typename OutputT, typename iStreamT>
+OutputT read_binary(iStreamT &inStream, std::error_code &ec)
+{
+    const std::string str = detail::read_file(inStream);
+    return read_binary<OutputT>(str.data(), str.data() + str.size(), ec);
+}
+
+template <typename OutputT, typename iStreamT>
+OutputT read_binary(iStreamT &inStream, bool *ok)
+{
+    const std::string str = detail::read_file(inStream);
+    return read_binary<OutputT>(str.data(), str.data() + str.size(), ok);
+}
+
+inline object read_binary(std::istream &inStream)
+{
+    return read_binary<object>(inStream);
+}
+
+inline object read_binary(std::istream &inStream, std::error_code &ec)
+{
+    return read_binary<object>(inStream, ec);
+}
+
+inline object read_binary(std::istream &inStream, bool *ok)
+{
+    return read_binary<object>(inStream, ok);
+}
+
+/** \brief appends the given object tree in binary KeyValues format to the
+given buffer.
+throws "std::runtime_error" if a value does not match its type hint
+*/
+template <typename T>
+void write_binary(std::string &out, const T &obj,
+                  const BinaryWriteOptions &opts = {})
+{
+    detail::write_binary_object(out, obj, opts);
+    out += static_cast<char>(binary_type::end);
+}
+
+/** \brief writes given object tree in binary KeyValues format to given stream
+(which should be opened with std::ios::binary). The data is serialized into
+one contiguous buffer and handed to the stream at once.
+throws "std::runtime_error" if a value does not match its type hint
+*/
+template <typename oStreamT, typename T>
+void write_binary(oStreamT &s, const T &obj,
+                  const BinaryWriteOptions &opts = {})
+{
+    std::string buffer;
+    write_binary(buffer, obj, opts);
+    s.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_BINARY_H__
@@ -0,0 +1,342 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_CACHE_H__
+#define __TYTI_STEAM_VDF_CACHE_H__
+
+#include "vdf_mapped_file.hpp"
+#include "vdf_parser.hpp"
+#include "vdf_snapshot.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/// counters of a parse_cache
+struct cache_statistics
+{
+    /// files served from memory
+    std::uint64_t hits = 0;
+    /// files loaded from the cache directory
+    std::uint64_t disk_hits = 0;
+    /// files which had to be parsed
+    std::uint64_t misses = 0;
+    /// size of all files which did not need to be parsed
+    std::uint64_t bytes_saved = 0;
+};
+
+namespace detail
+{
+const char cache_magic[8] = {'V', 'D', 'F', 'C', 'A', 'C', 'H', 'E'};
+enum : std::uint32_t
+{
+    cache_version = 2,
+    cache_header_size = 48
+};
+
+inline std::uint64_t fnv1a(const std::string &s) noexcept
+{
+    std::uint64_t h = UINT64_C(14695981039346656037);
+    for (const char c : s)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= UINT64_C(1099511628211);
+    }
+    return h;
+}
+
+/// the options a stored tree was parsed with, one bit per option which
+/// changes the parsed tree. compute_hashes is left out, since the hashes are
+/// not stored but computed after loading
+inline std::uint32_t options_bits(const Options &opt) noexcept
+{
+    std::uint32_t bits = 0;
+    bits |= opt.strip_escape_symbols ? 1u << 0 : 0u;
+    bits |= opt.ignore_all_platform_conditionals ? 1u << 1 : 0u;
+    bits |= opt.ignore_includes ? 1u << 2 : 0u;
+    bits |= opt.detect_encoding ? 1u << 3 : 0u;
+    bits |= opt.validate_utf8 ? 1u << 4 : 0u;
+    bits |= opt.recover_errors ? 1u << 5 : 0u;
+    return bits;
+}
+} // namespace detail
+
+/** \brief Cache of parsed files, keyed on the file identity.
+A file is only parsed again, if its canonical path, size, modification time
+or inode changed. Parsed trees are kept in memory and, if a cache directory is
+given, also stored there as snapshots, so they survive a restart.
+
+Only the identity of the given file is checked, changes in files included via
+#include/#base are not detected.
+Disk persistence requires OutputT to be basic_object<char> or
+basic_multikey_object<char>. All member functions are thread safe.
+*/
+template <typename OutputT = object> class basic_parse_cache
+{
+  public:
+    /**
+    @param opt          options passed to the parser
+    @param cache_dir    optional directory to persist parsed files in. It has
+                        to exist.
+    */
+    explicit basic_parse_cache(const Options &opt = Options{},
+                               std::string cache_dir = std::string())
+        : opt_(opt), cache_dir_(std::move(cache_dir))
+    {
+    }
+
+    /** \brief returns the parsed file, parses it only if it changed.
+    can throw:
+        - "std::system_error" if the file cannot be accessed
+        - "std::runtime_error" if a parsing error occured
+        - "std::bad_alloc" if not enough memory could be allocated
+    */
+    std::shared_ptr<const OutputT> get(const std::string &path)
+    {
+        const std::string key = detail::canonical_path(path);
+        detail::file_identity id;
+        if (!detail::stat_file(key, id))
+            throw std::system_error(errno, std::generic_category(),
+                                    "cannot stat " + path);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = entries_.find(key);
+            if (it != entries_.end() && it->second.identity == id)
+            {
+                ++stats_.hits;
+                stats_.bytes_saved += id.size;
+                return it->second.value;
+            }
+        }
+
+        std::shared_ptr<const OutputT> value = load(key, id);
+        if (value)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.disk_hits;
+            stats_.bytes_saved += id.size;
+        }
+        else
+        {
+            value = std::make_shared<const OutputT>(parse(key));
+            store(key, id, *value);
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.misses;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        entry &e = entries_[key];
+        e.identity = id;
+        e.value = value;
+        return value;
+    }
+
+    /// same as get, but reports errors via ec instead of exceptions
+    std::shared_ptr<const OutputT> get(const std::string &path,
+                                       std::error_code &ec) noexcept
+    {
+        ec.clear();
+        try
+        {
+            return get(path);
+        }
+        catch (std::system_error &e)
+        {
+            ec = e.code();
+        }
+        catch (std::runtime_error &)
+        {
+            ec = std::make_error_code(std::errc::protocol_error);
+        }
+        catch (std::bad_alloc &)
+        {
+            ec = std::make_error_code(std::errc::not_enough_memory);
+        }
+        catch (...)
+        {
+            ec = std::make_error_code(std::errc::invalid_argument);
+        }
+        return nullptr;
+    }
+
+    /// removes the file from the memory cache
+    void erase(const std::string &path)
+    {
+        std::string key;
+        try
+        {
+            key = detail::canonical_path(path);
+        }
+        catch (std::system_error &)
+        {
+            key = path;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.erase(key);
+    }
+
+    /// removes all files from the memory cache
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+    /// number of files in the memory cache
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    cache_statistics statistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+  private:
+    struct entry
+    {
+        detail::file_identity identity;
+        std::shared_ptr<const OutputT> value;
+    };
+
+    OutputT parse(const std::string &key) const
+    {
+        if (opt_.detect_encoding)
+        {
+            // the text is converted while reading, like read() does
+            std::ifstream in(key, std::ios::binary);
+            return read<OutputT>(in, opt_);
+        }
+        const detail::mapped_file file(key);
+        return read<OutputT>(file.begin(), file.end(), opt_);
+    }
+
+    std::string cache_file(const std::string &key) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.vdfcache",
+                      static_cast<unsigned long long>(detail::fnv1a(key)));
+        return cache_dir_ + "/" + name;
+    }
+
+    // layout: magic, version, options, size, mtime, inode,
+    // length of the path, path, snapshot
+    std::shared_ptr<const OutputT> load(const std::string &key,
+                                        const detail::file_identity &id) const
+    {
+        if (cache_dir_.empty())
+            return nullptr;
+        try
+        {
+            const detail::mapped_file file(cache_file(key));
+            const char *data = file.data();
+            if (file.size() < detail::cache_header_size ||
+                !std::equal(data, data + 8, detail::cache_magic) ||
+                detail::load_le32(data + 8) != detail::cache_version ||
+                detail::load_le32(data + 12) != detail::options_bits(opt_) ||
+                detail::load_le64(data + 16) != id.size ||
+                detail::load_le64(data + 24) !=
+                    static_cast<std::uint64_t>(id.mtime_ns) ||
+                detail::load_le64(data + 32) != id.inode)
+                return nullptr;
+            const std::uint64_t path_size = detail::load_le64(data + 40);
+            if (path_size != key.size() ||
+                file.size() - detail::cache_header_size < path_size ||
+                key.compare(0, key.size(), data + detail::cache_header_size,
+                            key.size()) != 0)
+                return nullptr;
+
+            const char *snap = data + detail::cache_header_size + path_size;
+            const snapshot s(std::string(snap, file.end()));
+            auto value =
+                std::make_shared<OutputT>(s.root().to_object<OutputT>());
+            // snapshots do not store the hashes
+            if (opt_.compute_hashes)
+                update_hashes(*value);
+            return value;
+        }
+        catch (std::exception &)
+        {
+            // missing or corrupted cache files are just misses
+            return nullptr;
+        }
+    }
+
+    void store(const std::string &key, const detail::file_identity &id,
+               const OutputT &value) const
+    {
+        if (cache_dir_.empty())
+            return;
+        std::string data(detail::cache_magic, 8);
+        detail::store_le32(data, detail::cache_version);
+        detail::store_le32(data, detail::options_bits(opt_));
+        detail::store_le64(data, id.size);
+        detail::store_le64(data, static_cast<std::uint64_t>(id.mtime_ns));
+        detail::store_le64(data, id.inode);
+        detail::store_le64(data, key.size());
+        data += key;
+        write_snapshot(data, value);
+
+        // every writer uses its own temporary file, which is renamed over the
+        // cache file. So readers either see the old or the new file, never a
+        // partially written one
+        const std::string path = cache_file(key);
+        const std::string tmp = detail::temp_file_name(path);
+        bool written;
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            out.close();
+            written = !out.fail();
+        }
+        if (!written || !detail::replace_file(tmp, path))
+            std::remove(tmp.c_str());
+    }
+
+    const Options opt_;
+    const std::string cache_dir_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, entry> entries_;
+    cache_statistics stats_;
+};
+
+typedef basic_parse_cache<object> parse_cache;
+typedef basic_parse_cache<multikey_object> multikey_parse_cache;
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_CACHE_H__
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_COMPACT_H__
+#define __TYTI_STEAM_VDF_COMPACT_H__
+
+#include "vdf_parser.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/** \brief object with a wide character API, which stores its strings as
+UTF-8. For mostly ASCII data, the strings take a quarter of the memory of a
+wobject where wchar_t has 4 bytes. The wide strings are converted on every
+access and returned by value, so the object can be read from several threads
+at once.
+
+It is an output type of read(), both for wide text and for UTF-8 text, which
+is stored without any conversion:
+    auto root = read<compact_wobject>(text.begin(), text.end());
+
+Unlike wobject, it has no name, attribs and childs members, since wide maps
+would have to be stored to hand out references into them. The strings are
+accessed through name(), attribute(), child() and the for_each functions
+instead, utf8_attribs() and utf8_childs() expose the stored maps. Functions
+which take a wobject, like write(), need a copy made by to_wobject().
+*/
+class compact_wobject
+{
+  public:
+    typedef wchar_t char_type;
+    typedef std::unordered_map<std::string, std::string> attrib_map;
+    typedef std::unordered_map<std::string, std::shared_ptr<compact_wobject>>
+        child_map;
+
+    std::wstring name() const { return to_wstring(name_); }
+
+    std::size_t attribute_count() const noexcept { return attribs_.size(); }
+    std::size_t child_count() const noexcept { return childs_.size(); }
+
+    bool has_attribute(const std::wstring &key) const
+    {
+        return attribs_.find(to_utf8(key)) != attribs_.end();
+    }
+
+    /// throws "std::out_of_range" if there is no such attribute
+    std::wstring attribute(const std::wstring &key) const
+    {
+        return to_wstring(attribs_.at(to_utf8(key)));
+    }
+
+    bool has_child(const std::wstring &key) const
+    {
+        return childs_.find(to_utf8(key)) != childs_.end();
+    }
+
+    /// throws "std::out_of_range" if there is no such child
+    const compact_wobject &child(const std::wstring &key) const
+    {
+        return *childs_.at(to_utf8(key));
+    }
+
+    /// calls f(key, value) for every attribute, with wide strings
+    template <typename F> void for_each_attribute(F f) const
+    {
+        for (const auto &i : attribs_)
+            f(to_wstring(i.first), to_wstring(i.second));
+    }
+
+    /// calls f(key, child) for every child, with a wide key
+    template <typename F> void for_each_child(F f) const
+    {
+        for (const auto &i : childs_)
+        {
+            const compact_wobject &c = *i.second;
+            f(to_wstring(i.first), c);
+        }
+    }
+
+    /// the UTF-8 strings, as they are stored
+    const std::string &utf8_name() const noexcept { return name_; }
+    const attrib_map &utf8_attribs() const noexcept { return attribs_; }
+    const child_map &utf8_childs() const noexcept { return childs_; }
+
+    /// converts the whole tree, e.g. for write()
+    wobject to_wobject() const
+    {
+        wobject root;
+        std::stack<std::pair<const compact_wobject *, wobject *>> open;
+        open.emplace(this, &root);
+        while (!open.empty())
+        {
+            const compact_wobject &src = *open.top().first;
+            wobject &dst = *open.top().second;
+            open.pop();
+            dst.name = to_wstring(src.name_);
+            for (const auto &i : src.attribs_)
+                dst.attribs.emplace(to_wstring(i.first),
+                                    to_wstring(i.second));
+            for (const auto &i : src.childs_)
+            {
+                auto c = std::make_shared<wobject>();
+                dst.childs.emplace(to_wstring(i.first), c);
+                open.emplace(i.second.get(), c.get());
+            }
+        }
+        return root;
+    }
+
+    // output type interface of read(), for wide and for UTF-8 text
+    void add_attribute(const std::wstring &key, const std::wstring &value)
+    {
+        add_attribute(narrow(key), narrow(value));
+    }
+    void add_attribute(std::string key, std::string value)
+    {
+        attribs_.emplace(std::move(key), std::move(value));
+    }
+    void add_child(std::unique_ptr<compact_wobject> child)
+    {
+        std::shared_ptr<compact_wobject> obj{child.release()};
+        childs_.emplace(obj->name_, obj);
+    }
+    void set_name(const std::wstring &n) { set_name(narrow(n)); }
+    void set_name(std::string n) { name_ = std::move(n); }
+
+  private:
+    /// to_utf8() reserves for the worst case, the stored strings should not
+    /// keep the unused capacity
+    static std::string narrow(const std::wstring &s)
+    {
+        std::string out = to_utf8(s);
+        out.shrink_to_fit();
+        return out;
+    }
+
+    std::string name_;
+    attrib_map attribs_;
+    child_map childs_;
+};
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_COMPACT_H__
@@ -0,0 +1,228 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_DIFF_H__
+#define __TYTI_STEAM_VDF_DIFF_H__
+
+#include "vdf_parser.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <stack>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+
+enum class change_type : unsigned char
+{
+    added,
+    removed,
+    changed
+};
+
+/// one entry of the edit script created by diff()
+template <typename T> struct basic_change
+{
+    typedef std::basic_string<typename T::char_type> string_type;
+
+    change_type type;
+    /// keys from below the root down to the changed attribute or child. The
+    /// last key is the one of the changed entry
+    std::vector<string_type> path;
+    /// true for attributes, false for childs
+    bool attribute;
+    /// values of attributes, empty if the attribute does not exist on the
+    /// respective side
+    string_type old_value;
+    string_type new_value;
+    /// added and removed childs. Changed childs are not reported themselves,
+    /// only the changes inside of them
+    std::shared_ptr<T> old_child;
+    std::shared_ptr<T> new_child;
+};
+
+typedef basic_change<object> change;
+typedef basic_change<multikey_object> multikey_change;
+
+namespace detail
+{
+/// true, if the subtrees are known to be equal by their hashes
+template <typename T> bool same_hash(const T &lhs, const T &rhs) noexcept
+{
+    return lhs.hash != 0 && lhs.hash == rhs.hash;
+}
+
+/// calls f(key, first_lhs, last_lhs, first_rhs, last_rhs) for every key of
+/// lhs and rhs, with the entries of both sides which have that key
+template <typename MapT, typename F>
+void join_keys(const MapT &lhs, const MapT &rhs, F f)
+{
+    // entries with the same key are adjacent, every key is visited once
+    const typename MapT::key_type *prev = nullptr;
+    for (const auto &i : lhs)
+    {
+        if (prev && *prev == i.first)
+            continue;
+        prev = &i.first;
+        const auto l = lhs.equal_range(i.first);
+        const auto r = rhs.equal_range(i.first);
+        f(i.first, l.first, l.second, r.first, r.second);
+    }
+    prev = nullptr;
+    for (const auto &i : rhs)
+    {
+        if (prev && *prev == i.first)
+            continue;
+        prev = &i.first;
+        if (lhs.find(i.first) != lhs.end())
+            continue;
+        const auto r = rhs.equal_range(i.first);
+        f(i.first, lhs.end(), lhs.end(), r.first, r.second);
+    }
+}
+} // namespace detail
+
+/** \brief computes the changes from the tree before to the tree after.
+Childs and attributes are matched by their keys. Entries with the same key in
+multikey objects are matched in the order the container iterates them.
+Subtrees with the same hash are skipped, so if both trees were parsed with
+Options::compute_hashes, or hashed by update_hashes(), the time is
+proportional to the size of the objects along the changed paths and not to
+the size of the trees. Without hashes, the trees are compared completely.
+The names of the roots are not compared. The changes are in no particular
+order.
+can throw:
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+template <typename T>
+std::vector<basic_change<T>> diff(const T &before, const T &after)
+{
+    typedef basic_change<T> change_t;
+    typedef typename change_t::string_type string_type;
+    typedef typename decltype(before.childs)::const_iterator child_iter;
+    typedef typename decltype(before.attribs)::const_iterator attrib_iter;
+
+    std::vector<change_t> changes;
+    struct frame
+    {
+        const T *before;
+        const T *after;
+        std::vector<string_type> path;
+    };
+    std::stack<frame> open;
+    if (!detail::same_hash(before, after))
+        open.push(frame{&before, &after, {}});
+
+    while (!open.empty())
+    {
+        frame f = std::move(open.top());
+        open.pop();
+        auto entry = [&f](change_type type, const string_type &key,
+                          bool attribute)
+        {
+            change_t c;
+            c.type = type;
+            c.path = f.path;
+            c.path.push_back(key);
+            c.attribute = attribute;
+            return c;
+        };
+
+        detail::join_keys(
+            f.before->attribs, f.after->attribs,
+            [&](const string_type &key, attrib_iter l, attrib_iter l_end,
+                attrib_iter r, attrib_iter r_end)
+            {
+                for (; l != l_end && r != r_end; ++l, ++r)
+                {
+                    if (l->second == r->second)
+                        continue;
+                    change_t c = entry(change_type::changed, key, true);
+                    c.old_value = l->second;
+                    c.new_value = r->second;
+                    changes.push_back(std::move(c));
+                }
+                for (; l != l_end; ++l)
+                {
+                    change_t c = entry(change_type::removed, key, true);
+                    c.old_value = l->second;
+                    changes.push_back(std::move(c));
+                }
+                for (; r != r_end; ++r)
+                {
+                    change_t c = entry(change_type::added, key, true);
+                    c.new_value = r->second;
+                    changes.push_back(std::move(c));
+                }
+            });
+
+        detail::join_keys(
+            f.before->childs, f.after->childs,
+            [&](const string_type &key, child_iter l, child_iter l_end,
+                child_iter r, child_iter r_end)
+            {
+                for (; l != l_end && r != r_end; ++l, ++r)
+                {
+                    if (l->second == r->second)
+                        continue;
+                    if (!l->second || !r->second)
+                    {
+                        change_t c = entry(l->second ? change_type::removed
+                                                     : change_type::added,
+                                           key, false);
+                        c.old_child = l->second;
+                        c.new_child = r->second;
+                        changes.push_back(std::move(c));
+                        continue;
+                    }
+                    if (detail::same_hash(*l->second, *r->second))
+                        continue;
+                    frame child{l->second.get(), r->second.get(), f.path};
+                    child.path.push_back(key);
+                    open.push(std::move(child));
+                }
+                for (; l != l_end; ++l)
+                {
+                    change_t c = entry(change_type::removed, key, false);
+                    c.old_child = l->second;
+                    changes.push_back(std::move(c));
+                }
+                for (; r != r_end; ++r)
+                {
+                    change_t c = entry(change_type::added, key, false);
+                    c.new_child = r->second;
+                    changes.push_back(std::move(c));
+                }
+            });
+    }
+    return changes;
+}
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_DIFF_H__
@@ -0,0 +1,900 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_DOCUMENT_H__
+#define __TYTI_STEAM_VDF_DOCUMENT_H__
+
+#include "vdf_parser.hpp"
+#include "vdf_patch.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+namespace detail
+{
+/// prefix sums over a sequence of lengths (a fenwick tree). Changing a
+/// length and finding the entry at an offset take logarithmic time
+class offset_tree
+{
+  public:
+    /// replaces all lengths, in linear time
+    void assign(const std::vector<size_t> &lengths)
+    {
+        tree_.assign(lengths.size() + 1, 0);
+        total_ = 0;
+        for (size_t i = 1; i <= lengths.size(); ++i)
+        {
+            tree_[i] += lengths[i - 1];
+            total_ += lengths[i - 1];
+            const size_t parent = i + (i & (~i + 1));
+            if (parent < tree_.size())
+                tree_[parent] += tree_[i];
+        }
+    }
+
+    /// number of lengths
+    size_t size() const noexcept
+    {
+        return tree_.empty() ? 0 : tree_.size() - 1;
+    }
+
+    /// sum of all lengths
+    size_t total() const noexcept { return total_; }
+
+    /// sum of the first n lengths
+    size_t prefix(size_t n) const noexcept
+    {
+        size_t sum = 0;
+        for (; n > 0; n &= n - 1)
+            sum += tree_[n];
+        return sum;
+    }
+
+    /// adds delta to the length at index i
+    void add(size_t i, std::ptrdiff_t delta) noexcept
+    {
+        // unsigned arithmetic wraps around for negative deltas
+        const size_t d = static_cast<size_t>(delta);
+        total_ += d;
+        for (++i; i < tree_.size(); i += i & (~i + 1))
+            tree_[i] += d;
+    }
+
+    /// index of the entry containing offset, size() if offset is behind
+    /// all entries
+    size_t find(size_t offset) const noexcept
+    {
+        size_t step = 1;
+        while (step <= size())
+            step <<= 1;
+        size_t pos = 0;
+        for (step >>= 1; step > 0; step >>= 1)
+            if (pos + step < tree_.size() && tree_[pos + step] <= offset)
+            {
+                pos += step;
+                offset -= tree_[pos];
+            }
+        return pos;
+    }
+
+  private:
+    std::vector<size_t> tree_;
+    size_t total_ = 0;
+};
+} // namespace detail
+
+/** \brief vdf text together with its parsed tree, which is updated
+incrementally when the text is edited.
+The body of every object is split into items: the whitespace and comments in
+front of a key together with the key and its value or object. An edit only
+re-tokenizes the items it touches, plus the item in front of them if its last
+token could continue into the edit, and replaces their attributes and objects.
+All other nodes stay untouched. The items of a body are kept in a fenwick
+tree, so the offsets of the items behind an edit are updated in logarithmic
+time. Only edits which add or remove items move the item entries behind
+them. If the items cannot be parsed on their own, e.g. because a brace was
+inserted, the items of the parent are tried, up to the whole text. The text
+itself is stored in one string, so an edit still moves the characters behind
+it.
+
+The tokens follow the rules of read(). The tree differs from read() in:
+    - #include and #base are not resolved
+    - a value behind a fulfilled conditional, e.g. "key" [$WIN32] "value",
+      is used as written, read() adds the whitespace in front of it
+    - a '}' is a value behind a key, read() rejects it behind a comment
+    - text which read() only accepts with Options::recover_errors is
+      rejected
+OutputT has to be basic_object or basic_multikey_object.
+*/
+template <typename OutputT = object> class basic_document
+{
+  public:
+    typedef typename OutputT::char_type char_type;
+    typedef std::basic_string<char_type> string_type;
+
+    /** \brief parses the given text.
+    can throw:
+        - "std::runtime_error" if a parsing error occured
+        - "std::bad_alloc" if not enough memory could be allocated
+    */
+    explicit basic_document(string_type text, const Options &opt = Options{})
+        : text_(std::move(text)), opt_(opt)
+    {
+        top_range_.obj = &top_;
+        reparse_all(top_range_, 0, text_.size(), true);
+        reparsed_ = text_.size();
+    }
+
+    basic_document(const basic_document &) = delete;
+    basic_document &operator=(const basic_document &) = delete;
+
+    const string_type &text() const noexcept { return text_; }
+
+    /// the parsed tree, see the class description for the differences to
+    /// read()
+    const OutputT &root() const noexcept
+    {
+        if (top_range_.objects == 1)
+            for (const item &i : top_range_.items)
+                if (i.child && i.child->obj)
+                    return *i.child->obj;
+        return top_;
+    }
+
+    /// false, if the text could not be parsed after the last edit. root()
+    /// then still holds the last valid tree
+    bool valid() const noexcept { return valid_; }
+
+    /// number of characters which were tokenized by the last edit
+    size_t reparsed() const noexcept { return reparsed_; }
+
+    /** \brief replaces removed characters at offset by inserted and updates
+    the tree.
+    @return false, if the new text cannot be parsed
+    can throw:
+        - "std::out_of_range" if the edited range is outside of the text
+        - "std::bad_alloc" if not enough memory could be allocated
+    */
+    bool edit(size_t offset, size_t removed, const string_type &inserted)
+    {
+        if (offset > text_.size() || removed > text_.size() - offset)
+            throw std::out_of_range("edit outside of the document");
+
+        // the parent of the roots and the objects whose bodies contain the
+        // edited range
+        std::vector<path_entry> path{path_entry{&top_range_, 0, 0}};
+        while (valid_)
+        {
+            const path_entry &cur = path.back();
+            const range &r = *cur.r;
+            const size_t idx = r.offsets.find(offset - cur.body_begin);
+            if (idx == r.items.size() || !r.items[idx].child)
+                break;
+            range *child = r.items[idx].child.get();
+            const size_t body = cur.body_begin + r.offsets.prefix(idx) +
+                                r.items[idx].child_offset + child->body;
+            if (offset < body || offset + removed > body + length(*child))
+                break;
+            path.push_back(path_entry{child, body, idx});
+        }
+
+        text_.replace(offset, removed, inserted);
+        const std::ptrdiff_t delta =
+            static_cast<std::ptrdiff_t>(inserted.size()) -
+            static_cast<std::ptrdiff_t>(removed);
+
+        if (!valid_)
+        {
+            reparsed_ = text_.size();
+            try
+            {
+                reparse_all(top_range_, 0, text_.size(), true);
+                valid_ = true;
+            }
+            catch (std::runtime_error &)
+            {
+            }
+            return valid_;
+        }
+
+        for (size_t level = path.size(); level-- > 0;)
+        {
+            try
+            {
+                reparse_edit(path, level, offset, removed, delta);
+                return true;
+            }
+            catch (std::runtime_error &)
+            {
+                // try the parent
+            }
+        }
+        // the items of the roots cannot be parsed, so neither can the text
+        valid_ = false;
+        return false;
+    }
+
+  private:
+    typedef typename decltype(OutputT::attribs)::value_type attrib_entry;
+    struct range;
+
+    /// whitespace and comments in front of a key, together with the key and
+    /// its value or object
+    struct item
+    {
+        /// characters from the begin of the item to the begin of the next
+        /// one
+        size_t width = 0;
+        /// offset of the first token
+        size_t lead = 0;
+        /// offset of the name of the object
+        size_t child_offset = 0;
+        /// the object of the item, nullptr for attributes
+        std::unique_ptr<range> child;
+        /// the attribute in the parent object, nullptr if the item is no
+        /// attribute or if it was dropped
+        attrib_entry *attrib = nullptr;
+        /// the attribute or object was dropped as duplicate
+        bool dropped = false;
+    };
+
+    /// byte range of an object
+    struct range
+    {
+        /// offset behind the '{', relative to the name of the object
+        size_t body = 0;
+        /// nullptr, if the object was dropped as duplicate
+        OutputT *obj = nullptr;
+        std::vector<item> items;
+        /// begins of the items, relative to the body
+        detail::offset_tree offsets;
+        /// whitespace and comments behind the last item
+        size_t tail = 0;
+        /// number of items which are objects
+        size_t objects = 0;
+        /// number of items which were dropped as duplicates
+        size_t dropped = 0;
+        /// results of detail::hash_entries for the attribs and childs of obj
+        std::uint64_t attribs_hash = 0;
+        std::uint64_t childs_hash = 0;
+    };
+
+    struct path_entry
+    {
+        range *r;
+        /// absolute offset of the body
+        size_t body_begin;
+        /// index in the items of the parent range
+        size_t index;
+    };
+
+    /// attribute or object parsed for an item, which is not added to the
+    /// tree yet
+    struct pending
+    {
+        bool attrib = false;
+        string_type key;
+        string_type value;
+        std::unique_ptr<OutputT> obj;
+    };
+
+    /// items parsed from a part of a body
+    struct scan_result
+    {
+        std::vector<item> items;
+        std::vector<pending> content;
+        /// index of the first old item, which was not parsed again
+        size_t stop = 0;
+        /// the items were parsed up to the end of the body, tail is new
+        bool to_end = false;
+        size_t tail = 0;
+        /// absolute offset where parsing started and stopped
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    static size_t length(const range &r) noexcept
+    {
+        return r.offsets.total() + r.tail;
+    }
+
+    static size_t shifted(size_t v, std::ptrdiff_t delta) noexcept
+    {
+        return static_cast<size_t>(static_cast<std::ptrdiff_t>(v) + delta);
+    }
+
+    static bool is_include_key(const string_type &key)
+    {
+        const char_type include[] = {'#', 'i', 'n', 'c', 'l',
+                                     'u', 'd', 'e', 0};
+        const char_type base[] = {'#', 'b', 'a', 's', 'e', 0};
+        return key == include || key == base;
+    }
+
+    template <typename It>
+    static attrib_entry *inserted(std::pair<It, bool> result) noexcept
+    {
+        return result.second ? &*result.first : nullptr;
+    }
+    template <typename It> static attrib_entry *inserted(It it) noexcept
+    {
+        return &*it;
+    }
+
+    static void erase_attrib(OutputT &obj, const attrib_entry *entry)
+    {
+        const auto same_key = obj.attribs.equal_range(entry->first);
+        for (auto it = same_key.first; it != same_key.second; ++it)
+            if (&*it == entry)
+            {
+                obj.attribs.erase(it);
+                return;
+            }
+    }
+
+    static void erase_child(OutputT &obj, const OutputT *child)
+    {
+        const auto same_name = obj.childs.equal_range(child->name);
+        for (auto it = same_name.first; it != same_name.second; ++it)
+            if (it->second.get() == child)
+            {
+                obj.childs.erase(it);
+                return;
+            }
+    }
+
+    /// adds child to parent and returns it, or nullptr if it was dropped
+    static OutputT *attach(OutputT &parent, std::unique_ptr<OutputT> child)
+    {
+        OutputT *raw = child.get();
+        const string_type name = child->name;
+        parent.add_child(std::move(child));
+        const auto same_name = parent.childs.equal_range(name);
+        for (auto it = same_name.first; it != same_name.second; ++it)
+            if (it->second.get() == raw)
+                return raw;
+        return nullptr;
+    }
+
+    /// clears the objects of the ranges below r, after the object of r was
+    /// dropped together with its childs
+    static void detach(range &r) noexcept
+    {
+        std::vector<range *> open{&r};
+        while (!open.empty())
+        {
+            range *cur = open.back();
+            open.pop_back();
+            cur->obj = nullptr;
+            for (auto &i : cur->items)
+                if (i.child)
+                    open.push_back(i.child.get());
+        }
+    }
+
+    static void rebuild_offsets(range &r)
+    {
+        std::vector<size_t> widths;
+        widths.reserve(r.items.size());
+        for (const item &i : r.items)
+            widths.push_back(i.width);
+        r.offsets.assign(widths);
+    }
+
+    /// sets the hash of obj from the sums stored in r
+    void rehash(const range &r, OutputT &obj) const
+    {
+        if (opt_.compute_hashes)
+            set_hash(r, obj, detail::has_hash<OutputT>{});
+    }
+    static void set_hash(const range &r, OutputT &obj, std::true_type)
+    {
+        obj.hash = detail::hash_node(obj.name, r.attribs_hash, r.childs_hash);
+    }
+    static void set_hash(const range &, OutputT &, std::false_type) {}
+
+    /// replaces the content of r by the whole body, which ends at the
+    /// absolute offset body_end
+    void reparse_all(range &r, size_t body_begin, size_t body_end, bool top)
+    {
+        scan_result res =
+            scan(r, body_begin, body_end, top, 0, r.items.size(), 0);
+        OutputT *obj = r.obj;
+        if (obj)
+        {
+            obj->attribs.clear();
+            obj->childs.clear();
+        }
+        for (size_t n = 0; n < res.items.size(); ++n)
+            add_content(obj, res.items[n], res.content[n]);
+
+        r.items = std::move(res.items);
+        rebuild_offsets(r);
+        r.tail = res.tail;
+        r.objects = 0;
+        r.dropped = 0;
+        for (const item &i : r.items)
+        {
+            r.objects += i.child ? 1u : 0u;
+            r.dropped += i.dropped ? 1u : 0u;
+        }
+        if (obj && opt_.compute_hashes)
+        {
+            r.attribs_hash = detail::hash_entries(obj->attribs);
+            r.childs_hash = detail::hash_entries(obj->childs);
+            rehash(r, *obj);
+        }
+    }
+
+    /// adds the parsed content of i to obj, duplicates are dropped
+    static void add_content(OutputT *obj, item &i, pending &p)
+    {
+        if (p.attrib && obj)
+        {
+            i.attrib = inserted(
+                obj->attribs.emplace(std::move(p.key), std::move(p.value)));
+            i.dropped = !i.attrib;
+        }
+        else if (p.obj)
+        {
+            i.child->obj = obj ? attach(*obj, std::move(p.obj)) : nullptr;
+            if (!i.child->obj)
+            {
+                detach(*i.child);
+                i.dropped = obj != nullptr;
+            }
+        }
+    }
+
+    /// parses the items of path[level] touched by the edit again.
+    /// throws "std::runtime_error" if they cannot be parsed on their own
+    void reparse_edit(const std::vector<path_entry> &path, size_t level,
+                      size_t offset, size_t removed, std::ptrdiff_t delta)
+    {
+        range &r = *path[level].r;
+        const size_t body_begin = path[level].body_begin;
+        const bool top = level == 0;
+        const size_t count = r.items.size();
+
+        // the touched items. The last token of the item in front of them can
+        // continue into the edit, unless it is a '}', or a value can get a
+        // conditional
+        const size_t rel = offset - body_begin;
+        const size_t i = r.offsets.find(rel);
+        size_t first = i;
+        if (i > 0 && !r.items[i - 1].child &&
+            rel <= r.offsets.prefix(i) +
+                       (i < count ? r.items[i].lead : r.tail))
+            first = i - 1;
+        const size_t end = rel + removed;
+        size_t keep = r.offsets.find(end);
+        if (keep < count && r.offsets.prefix(keep) != end)
+            ++keep;
+
+        const size_t body_end = shifted(body_begin + length(r), delta);
+        scan_result res =
+            scan(r, body_begin, body_end, top, first, keep, delta);
+        reparsed_ = res.end - res.begin;
+
+        // hashes of the objects containing r in their parents, before r
+        // changes. Dropped objects are not part of the tree
+        std::vector<std::uint64_t> old_hashes;
+        if (opt_.compute_hashes)
+            for (size_t n = 1; n <= level && path[n].r->obj; ++n)
+                old_hashes.push_back(detail::hash_entries(
+                    path[n - 1].r->obj->childs, path[n].r->obj->name));
+
+        if (!replace_items(r, first, res))
+            reparse_all(r, body_begin, body_end, top);
+
+        // the objects containing r grew
+        for (size_t n = level; n-- > 0;)
+        {
+            range &parent = *path[n].r;
+            item &child = parent.items[path[n + 1].index];
+            child.width = shifted(child.width, delta);
+            parent.offsets.add(path[n + 1].index, delta);
+        }
+        if (old_hashes.size() == level)
+            for (size_t n = level; n > 0; --n)
+            {
+                range &parent = *path[n - 1].r;
+                parent.childs_hash +=
+                    detail::hash_entries(parent.obj->childs,
+                                         path[n].r->obj->name) -
+                    old_hashes[n - 1];
+                rehash(parent, *parent.obj);
+            }
+    }
+
+    /// replaces the items [first, res.stop) of r by the parsed ones.
+    /// @return false if keys are duplicated, then the whole body has to be
+    /// parsed again, so that the right duplicates are dropped
+    bool replace_items(range &r, size_t first, scan_result &res)
+    {
+        OutputT *obj = r.obj;
+        if (obj)
+        {
+            if (r.dropped != 0)
+                return false;
+            std::vector<string_type> keys;
+            std::vector<string_type> names;
+            for (size_t n = first; n < res.stop; ++n)
+            {
+                const item &i = r.items[n];
+                if (i.attrib)
+                    keys.push_back(i.attrib->first);
+                if (i.child && i.child->obj)
+                    names.push_back(i.child->obj->name);
+            }
+            for (const pending &p : res.content)
+            {
+                if (p.attrib)
+                    keys.push_back(p.key);
+                if (p.obj)
+                    names.push_back(p.obj->name);
+            }
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            std::sort(names.begin(), names.end());
+            names.erase(std::unique(names.begin(), names.end()), names.end());
+
+            // multikey objects keep the order of duplicates, which is only
+            // kept by parsing the whole body
+            const auto unique = [&]
+            {
+                for (const string_type &k : keys)
+                    if (obj->attribs.count(k) > 1)
+                        return false;
+                for (const string_type &k : names)
+                    if (obj->childs.count(k) > 1)
+                        return false;
+                return true;
+            };
+            if (!unique())
+                return false;
+
+            if (opt_.compute_hashes)
+            {
+                for (const string_type &k : keys)
+                    r.attribs_hash -= detail::hash_entries(obj->attribs, k);
+                for (const string_type &k : names)
+                    r.childs_hash -= detail::hash_entries(obj->childs, k);
+            }
+            for (size_t n = first; n < res.stop; ++n)
+            {
+                const item &i = r.items[n];
+                if (i.attrib)
+                    erase_attrib(*obj, i.attrib);
+                if (i.child && i.child->obj)
+                    erase_child(*obj, i.child->obj);
+            }
+            for (size_t n = 0; n < res.items.size(); ++n)
+            {
+                add_content(obj, res.items[n], res.content[n]);
+                if (res.items[n].dropped)
+                    return false;
+            }
+            if (!unique())
+                return false;
+            if (opt_.compute_hashes)
+            {
+                for (const string_type &k : keys)
+                    r.attribs_hash += detail::hash_entries(obj->attribs, k);
+                for (const string_type &k : names)
+                    r.childs_hash += detail::hash_entries(obj->childs, k);
+                rehash(r, *obj);
+            }
+        }
+        else
+        {
+            // the content of dropped objects is not part of the tree
+            for (item &i : res.items)
+                if (i.child)
+                    detach(*i.child);
+        }
+
+        for (size_t n = first; n < res.stop; ++n)
+            r.objects -= r.items[n].child ? 1u : 0u;
+        for (const item &i : res.items)
+            r.objects += i.child ? 1u : 0u;
+        if (res.stop - first == res.items.size())
+        {
+            for (size_t n = 0; n < res.items.size(); ++n)
+            {
+                item &old = r.items[first + n];
+                r.offsets.add(first + n,
+                              static_cast<std::ptrdiff_t>(res.items[n].width) -
+                                  static_cast<std::ptrdiff_t>(old.width));
+                old = std::move(res.items[n]);
+            }
+        }
+        else
+        {
+            const auto begin =
+                r.items.begin() + static_cast<std::ptrdiff_t>(first);
+            r.items.erase(begin, r.items.begin() +
+                                     static_cast<std::ptrdiff_t>(res.stop));
+            r.items.insert(r.items.begin() +
+                               static_cast<std::ptrdiff_t>(first),
+                           std::make_move_iterator(res.items.begin()),
+                           std::make_move_iterator(res.items.end()));
+            rebuild_offsets(r);
+        }
+        if (res.to_end)
+            r.tail = res.tail;
+        return true;
+    }
+
+    /** \brief parses the items of r, starting with the item first, until
+    the text reaches an old item, which is not in front of keep, or the end
+    of the body at the absolute offset body_end. delta is the size change of
+    the text in front of the old items from keep on.
+    The attributes and objects of the items are returned as pending, all
+    objects below them are built completely.
+    throws "std::runtime_error" if the items cannot be parsed on their own
+    */
+    scan_result scan(const range &r, size_t body_begin, size_t body_end,
+                     bool top, size_t first, size_t keep,
+                     std::ptrdiff_t delta) const
+    {
+        typedef detail::scan_token<char_type> token;
+        typedef detail::token_scanner<char_type> scanner_t;
+        const size_t none = static_cast<size_t>(-1);
+        const char_type *base = text_.data();
+
+        scan_result res;
+        res.begin = body_begin + r.offsets.prefix(first);
+        const char_type *last = base + body_end;
+        scanner_t scanner(base + res.begin, last, opt_);
+
+        // the next old item, which can end the scan
+        const size_t count = r.items.size();
+        size_t next = keep;
+        size_t next_begin = shifted(body_begin + r.offsets.prefix(keep), delta);
+
+        struct level
+        {
+            std::unique_ptr<OutputT> obj;
+            std::unique_ptr<range> r;
+            /// absolute offsets of the name, of the current item and of the
+            /// first token of the current item
+            size_t name_begin;
+            size_t item_begin;
+            size_t lead;
+        };
+        // the first level collects the items of the scanned part
+        std::vector<level> lvls;
+        lvls.push_back(level{nullptr, std::make_unique<range>(), 0,
+                             res.begin, none});
+
+        const auto end_item = [&lvls, &res, none](size_t end, item i,
+                                                  pending p)
+        {
+            level &l = lvls.back();
+            i.width = end - l.item_begin;
+            i.lead = l.lead - l.item_begin;
+            l.item_begin = end;
+            l.lead = none;
+            if (lvls.size() == 1)
+                res.content.push_back(std::move(p));
+            l.r->items.push_back(std::move(i));
+        };
+
+        string_type key;
+        size_t key_begin = 0;
+        bool has_key = false;
+
+        for (;;)
+        {
+            const token t =
+                scanner.next(has_key ? scanner_t::value : scanner_t::key);
+            if (t.kind == token::eof)
+            {
+                if (lvls.size() > 1)
+                    throw std::runtime_error("object opened, but not closed");
+                if (has_key)
+                    throw std::runtime_error("key declared, but no value");
+                if (!top && (t.begin != last || scanner.truncated()))
+                    throw std::runtime_error("body ends inside of a token");
+                res.stop = count;
+                res.to_end = true;
+                res.tail = body_end - lvls.back().item_begin;
+                res.end = body_end;
+                break;
+            }
+
+            if (lvls.back().lead == none)
+                lvls.back().lead =
+                    static_cast<size_t>(t.begin - base) -
+                    (t.quoted || t.kind == token::conditional ? 1 : 0);
+
+            bool item_ended = false;
+            switch (t.kind)
+            {
+            case token::string:
+                if (!has_key)
+                {
+                    key = scanner.str(t);
+                    key_begin = static_cast<size_t>(t.begin - base) -
+                                (t.quoted ? 1 : 0);
+                    has_key = true;
+                }
+                else
+                {
+                    has_key = false;
+                    string_type value = scanner.str(t);
+
+                    // a conditional behind the value decides, whether it is
+                    // used
+                    const char_type *pos = scanner.position();
+                    const token cond = scanner.next();
+                    bool used = true;
+                    if (cond.kind != token::conditional)
+                        scanner.seek(pos);
+                    else
+                        used = detail::conditional_fulfilled(
+                            string_type(cond.begin, cond.end), opt_);
+
+                    item i;
+                    pending p;
+                    if (used && !is_include_key(key))
+                    {
+                        if (top && lvls.size() == 1)
+                            throw std::runtime_error(
+                                "unexpected key without object");
+                        level &l = lvls.back();
+                        if (lvls.size() == 1)
+                        {
+                            p.attrib = true;
+                            p.key = std::move(key);
+                            p.value = std::move(value);
+                        }
+                        else
+                        {
+                            i.attrib = inserted(l.obj->attribs.emplace(
+                                std::move(key), std::move(value)));
+                            i.dropped = !i.attrib;
+                            l.r->dropped += i.dropped ? 1u : 0u;
+                        }
+                    }
+                    end_item(static_cast<size_t>(scanner.position() - base),
+                             std::move(i), std::move(p));
+                    item_ended = true;
+                }
+                break;
+            case token::open:
+            {
+                if (!has_key)
+                    throw std::runtime_error("object without name");
+                has_key = false;
+                level l;
+                l.obj = std::make_unique<OutputT>();
+                l.obj->set_name(std::move(key));
+                l.r = std::make_unique<range>();
+                l.name_begin = key_begin;
+                l.item_begin = static_cast<size_t>(t.end - base);
+                l.lead = none;
+                l.r->body = l.item_begin - key_begin;
+                lvls.push_back(std::move(l));
+                break;
+            }
+            case token::close:
+            {
+                if (lvls.size() == 1)
+                    throw std::runtime_error("closing brace without object");
+                if (has_key)
+                    throw std::runtime_error("key declared, but no value");
+                level l = std::move(lvls.back());
+                lvls.pop_back();
+                l.r->tail = static_cast<size_t>(t.begin - base) - l.item_begin;
+                rebuild_offsets(*l.r);
+                if (opt_.compute_hashes)
+                {
+                    l.r->attribs_hash = detail::hash_entries(l.obj->attribs);
+                    l.r->childs_hash = detail::hash_entries(l.obj->childs);
+                    rehash(*l.r, *l.obj);
+                }
+
+                level &parent = lvls.back();
+                item i;
+                pending p;
+                i.child_offset = l.name_begin - parent.item_begin;
+                if (lvls.size() == 1)
+                {
+                    l.r->obj = l.obj.get();
+                    p.obj = std::move(l.obj);
+                }
+                else
+                {
+                    l.r->obj = attach(*parent.obj, std::move(l.obj));
+                    if (!l.r->obj)
+                        detach(*l.r);
+                    i.dropped = !l.r->obj;
+                    parent.r->dropped += i.dropped ? 1u : 0u;
+                }
+                ++parent.r->objects;
+                i.child = std::move(l.r);
+                end_item(static_cast<size_t>(t.end - base), std::move(i),
+                         std::move(p));
+                item_ended = true;
+                break;
+            }
+            default:
+                // an unfulfilled conditional behind a key drops it, like in
+                // read()
+                if (has_key && !detail::conditional_fulfilled(
+                                   string_type(t.begin, t.end), opt_))
+                {
+                    has_key = false;
+                    end_item(static_cast<size_t>(scanner.position() - base),
+                             item(), pending());
+                    item_ended = true;
+                }
+                break;
+            }
+
+            // stop at the begin of an old item behind the edit, whose
+            // tokens are unchanged
+            if (item_ended && lvls.size() == 1)
+            {
+                const size_t pos = lvls.back().item_begin;
+                while (next < count && next_begin < pos)
+                    next_begin += r.items[next++].width;
+                if (next < count && next_begin == pos)
+                {
+                    res.stop = next;
+                    res.end = pos;
+                    break;
+                }
+            }
+        }
+        res.items = std::move(lvls.front().r->items);
+        return res;
+    }
+
+    string_type text_;
+    const Options opt_;
+    /// parent of all root objects, like read() builds it for several roots
+    OutputT top_;
+    range top_range_;
+    bool valid_ = true;
+    size_t reparsed_ = 0;
+};
+
+typedef basic_document<object> document;
+typedef basic_document<wobject> wdocument;
+typedef basic_document<multikey_object> multikey_document;
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_DOCUMENT_H__
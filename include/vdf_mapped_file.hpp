@@ -0,0 +1,373 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_MAPPED_FILE_H__
+#define __TYTI_STEAM_VDF_MAPPED_FILE_H__
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define TYTI_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#define TYTI_UNDEF_NOMINMAX
+#endif
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <windows.h>
+#ifdef TYTI_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef TYTI_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifdef TYTI_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef TYTI_UNDEF_NOMINMAX
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tyti
+{
+namespace vdf
+{
+namespace detail
+{
+
+/// identifies a version of a file on disk
+struct file_identity
+{
+    std::uint64_t size = 0;
+    std::int64_t mtime_ns = 0;
+    std::uint64_t inode = 0;
+
+    bool operator==(const file_identity &o) const noexcept
+    {
+        return size == o.size && mtime_ns == o.mtime_ns && inode == o.inode;
+    }
+    bool operator!=(const file_identity &o) const noexcept
+    {
+        return !(*this == o);
+    }
+};
+
+/// resolves the absolute path of an existing file.
+/// throws "std::system_error" if the path cannot be resolved
+inline std::string canonical_path(const std::string &path)
+{
+#ifdef _WIN32
+    char buffer[_MAX_PATH];
+    if (!_fullpath(buffer, path.c_str(), _MAX_PATH))
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot resolve " + path);
+    return buffer;
+#else
+    char *resolved = ::realpath(path.c_str(), nullptr);
+    if (!resolved)
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot resolve " + path);
+    std::string result(resolved);
+    std::free(resolved);
+    return result;
+#endif
+}
+
+/// identity of the file at the given path. Returns false, if the file
+/// cannot be accessed
+inline bool stat_file(const std::string &path, file_identity &id) noexcept
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return false;
+    id.size = static_cast<std::uint64_t>(st.st_size);
+    id.mtime_ns = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+    id.inode = static_cast<std::uint64_t>(st.st_ino);
+#else
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return false;
+    id.size = static_cast<std::uint64_t>(st.st_size);
+#ifdef __APPLE__
+    id.mtime_ns =
+        static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+        st.st_mtimespec.tv_nsec;
+#else
+    id.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+                  st.st_mtim.tv_nsec;
+#endif
+    id.inode = static_cast<std::uint64_t>(st.st_ino);
+#endif
+    return true;
+}
+
+/// name for a temporary file next to path, which is unique across threads
+/// and processes
+inline std::string temp_file_name(const std::string &path)
+{
+    static std::atomic<std::uint64_t> counter(0);
+#ifdef _WIN32
+    const unsigned long long pid = GetCurrentProcessId();
+#else
+    const unsigned long long pid = static_cast<unsigned long long>(::getpid());
+#endif
+    char suffix[80];
+    std::snprintf(
+        suffix, sizeof(suffix), ".%llx.%llx.%llx.tmp", pid,
+        static_cast<unsigned long long>(
+            std::hash<std::thread::id>()(std::this_thread::get_id())),
+        static_cast<unsigned long long>(++counter));
+    return path + suffix;
+}
+
+/// atomically replaces target with source. Returns false on failure
+inline bool replace_file(const std::string &source,
+                         const std::string &target) noexcept
+{
+#ifdef _WIN32
+    return MoveFileExA(source.c_str(), target.c_str(),
+                       MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+/// truncates or extends the file at the given path.
+/// throws "std::system_error" if the file cannot be resized
+inline void resize_file(const std::string &path, std::uint64_t size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::system_error(static_cast<int>(GetLastError()),
+                                std::system_category(), "cannot open " + path);
+    LARGE_INTEGER pos;
+    pos.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(file))
+    {
+        const DWORD err = GetLastError();
+        CloseHandle(file);
+        throw std::system_error(static_cast<int>(err), std::system_category(),
+                                "cannot resize " + path);
+    }
+    CloseHandle(file);
+#else
+    if (::truncate(path.c_str(), static_cast<off_t>(size)) != 0)
+        throw std::system_error(errno, std::generic_category(),
+                                "cannot resize " + path);
+#endif
+}
+
+/// read-only memory mapping of a whole file
+class mapped_file
+{
+  public:
+    mapped_file() = default;
+
+    /// maps the file into memory.
+    /// throws "std::system_error" if the file cannot be opened or mapped
+    explicit mapped_file(const std::string &path) { open(path); }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file &&o) noexcept { swap(o); }
+    mapped_file &operator=(mapped_file &&o) noexcept
+    {
+        mapped_file tmp(std::move(o));
+        swap(tmp);
+        return *this;
+    }
+
+    ~mapped_file() { close(); }
+
+    const char *data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    const char *begin() const noexcept { return data_; }
+    const char *end() const noexcept { return data_ + size_; }
+
+    /// identity of the mapped file at the time it was opened
+    const file_identity &identity() const noexcept { return identity_; }
+
+    void swap(mapped_file &o) noexcept
+    {
+        std::swap(data_, o.data_);
+        std::swap(size_, o.size_);
+        std::swap(identity_, o.identity_);
+#ifdef _WIN32
+        std::swap(mapping_, o.mapping_);
+#endif
+    }
+
+  private:
+#ifdef _WIN32
+    void open(const std::string &path)
+    {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                  nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw_last_error("cannot open " + path);
+
+        BY_HANDLE_FILE_INFORMATION info;
+        if (!GetFileInformationByHandle(file, &info))
+        {
+            CloseHandle(file);
+            throw_last_error("cannot stat " + path);
+        }
+        identity_.size =
+            static_cast<std::uint64_t>(info.nFileSizeHigh) << 32 |
+            info.nFileSizeLow;
+        // FILETIME counts 100ns intervals
+        identity_.mtime_ns =
+            static_cast<std::int64_t>(
+                static_cast<std::uint64_t>(info.ftLastWriteTime.dwHighDateTime)
+                    << 32 |
+                info.ftLastWriteTime.dwLowDateTime) *
+            100;
+        identity_.inode =
+            static_cast<std::uint64_t>(info.nFileIndexHigh) << 32 |
+            info.nFileIndexLow;
+
+        size_ = static_cast<std::size_t>(identity_.size);
+        if (size_ != 0)
+        {
+            mapping_ =
+                CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping_)
+            {
+                CloseHandle(file);
+                throw_last_error("cannot map " + path);
+            }
+            data_ = static_cast<const char *>(
+                MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            if (!data_)
+            {
+                CloseHandle(mapping_);
+                CloseHandle(file);
+                mapping_ = nullptr;
+                throw_last_error("cannot map " + path);
+            }
+        }
+        CloseHandle(file);
+    }
+
+    void close() noexcept
+    {
+        if (data_)
+            UnmapViewOfFile(data_);
+        if (mapping_)
+            CloseHandle(mapping_);
+        data_ = nullptr;
+        mapping_ = nullptr;
+        size_ = 0;
+    }
+
+    [[noreturn]] static void throw_last_error(const std::string &what)
+    {
+        throw std::system_error(static_cast<int>(GetLastError()),
+                                std::system_category(), what);
+    }
+
+    HANDLE mapping_ = nullptr;
+#else
+    void open(const std::string &path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(),
+                                    "cannot open " + path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(),
+                                    "cannot stat " + path);
+        }
+        identity_.size = static_cast<std::uint64_t>(st.st_size);
+#ifdef __APPLE__
+        identity_.mtime_ns =
+            static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+            st.st_mtimespec.tv_nsec;
+#else
+        identity_.mtime_ns =
+            static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+            st.st_mtim.tv_nsec;
+#endif
+        identity_.inode = static_cast<std::uint64_t>(st.st_ino);
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ != 0)
+        {
+            void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                const int err = errno;
+                ::close(fd);
+                size_ = 0;
+                throw std::system_error(err, std::generic_category(),
+                                        "cannot map " + path);
+            }
+            data_ = static_cast<const char *>(p);
+        }
+        ::close(fd);
+    }
+
+    void close() noexcept
+    {
+        if (data_)
+            ::munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    file_identity identity_;
+};
+
+} // namespace detail
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_MAPPED_FILE_H__
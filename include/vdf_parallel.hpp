@@ -0,0 +1,202 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_PARALLEL_H__
+#define __TYTI_STEAM_VDF_PARALLEL_H__
+
+#include "vdf_parser.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+namespace detail
+{
+
+/// a part of the output. Either literal text written by the planner or a
+/// subtree which gets serialized by one of the workers
+template <typename charT, typename T> struct write_segment
+{
+    std::basic_string<charT> text;
+    const T *subtree = nullptr;
+    size_t tab = 0;
+};
+
+/// depth at which the tree gets split into subtrees, so that every worker
+/// gets several subtrees to balance uneven sizes
+template <typename T>
+size_t parallel_split_depth(const T &r, size_t min_subtrees)
+{
+    // give up splitting further at this depth, the framing is written
+    // sequentially
+    const size_t max_depth = 8;
+    std::vector<const T *> level{&r};
+    std::vector<const T *> next;
+    size_t depth = 0;
+    while (level.size() < min_subtrees && depth < max_depth)
+    {
+        next.clear();
+        for (const T *node : level)
+            for (const auto &i : node->childs)
+                if (i.second)
+                    next.push_back(i.second.get());
+        if (next.empty())
+            break;
+        level.swap(next);
+        ++depth;
+    }
+    return depth;
+}
+
+/// writes the objects above the split depth into literal segments and
+/// records every subtree at the split depth as its own segment
+template <typename charT, typename T>
+void plan_parallel_write(std::vector<write_segment<charT, T>> &segments,
+                         const T &r, const WriteOptions &opts, size_t tab,
+                         size_t split_depth)
+{
+    if (split_depth == 0 || r.childs.empty())
+    {
+        write_segment<charT, T> s;
+        s.subtree = &r;
+        s.tab = tab;
+        segments.push_back(std::move(s));
+        segments.emplace_back();
+        return;
+    }
+    std::basic_string<charT> &out = segments.back().text;
+    append_begin_object(out, r.name, opts, tab);
+    for (const auto &i : r.attribs)
+        append_key_value(out, i.first, i.second, opts, tab + 1);
+    for (const auto &i : r.childs)
+        if (i.second)
+            plan_parallel_write(segments, *i.second, opts, tab + 1,
+                                split_depth - 1);
+    append_end_object(segments.back().text, opts, tab);
+}
+
+} // namespace detail
+
+/** \brief appends given object tree in vdf format to the given string, using
+multiple threads.
+The tree is split into independent subtrees, which are serialized into their
+own buffers on a pool of threads and concatenated in order. The output is
+identical to the one of write().
+@param threads  number of threads, 0 uses std::thread::hardware_concurrency()
+can throw:
+    - "std::bad_alloc" if not enough memory could be allocated
+    - "std::system_error" if a thread could not be started
+*/
+template <typename charT, typename T>
+void write_parallel(std::basic_string<charT> &out, const T &r,
+                    const WriteOptions &opts = {}, unsigned threads = 0)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads <= 1)
+    {
+        write(out, r, opts);
+        return;
+    }
+
+    typedef detail::write_segment<charT, T> segment;
+    std::vector<segment> segments(1);
+    detail::plan_parallel_write(
+        segments, r, opts, 0,
+        detail::parallel_split_depth(r, size_t{4} * threads));
+
+    std::atomic<size_t> next_segment{0};
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    auto worker = [&]()
+    {
+        auto no_flush = [](std::basic_string<charT> &) {};
+        try
+        {
+            for (size_t i = next_segment++; i < segments.size() && !failed;
+                 i = next_segment++)
+            {
+                segment &s = segments[i];
+                if (s.subtree)
+                    detail::write_object(s.text, *s.subtree, opts, s.tab,
+                                         no_flush);
+            }
+        }
+        catch (...)
+        {
+            // only the first error is kept, the others stop on failed
+            if (!failed.exchange(true))
+                error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    try
+    {
+        for (unsigned i = 1; i < threads; ++i)
+            pool.emplace_back(worker);
+    }
+    catch (...)
+    {
+        failed = true;
+        for (auto &t : pool)
+            t.join();
+        throw;
+    }
+    worker();
+    for (auto &t : pool)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    size_t size = out.size();
+    for (const auto &s : segments)
+        size += s.text.size();
+    out.reserve(size);
+    for (const auto &s : segments)
+        out += s.text;
+}
+
+/** \brief writes given object tree in vdf format to given stream, using
+multiple threads. See write_parallel for strings.
+*/
+template <typename oStreamT, typename T>
+void write_parallel(oStreamT &s, const T &r, const WriteOptions &opts = {},
+                    unsigned threads = 0)
+{
+    std::basic_string<typename oStreamT::char_type> buffer;
+    write_parallel(buffer, r, opts, threads);
+    s.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_PARALLEL_H__
@@ -24,17 +24,20 @@
 #define __TYTI_STEAM_VDF_PARSER_H__
 
 #include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <iterator>
 #include <map>
 #include <memory>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <exception>
+#include <stdexcept>
 #include <system_error>
 
 // for wstring support
@@ -42,8 +45,29 @@
 #include <string>
 
 // internal
+#include <deque>
 #include <stack>
 
+// SSE2 is available on every x86-64 target. Define TYTI_VDF_NO_SIMD to use
+// the scalar code paths only
+#if !defined(TYTI_VDF_NO_SIMD) &&                                              \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TYTI_VDF_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// parsing works without exceptions, through the overloads reporting errors by
+// error codes. The throwing API aborts instead, if exceptions are disabled
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define TYTI_VDF_EXCEPTIONS
+#else
+#include <cstdlib>
+#endif
+
 // VS < 2015 has only partial C++11 support
 #if defined(_MSC_VER) && _MSC_VER < 1900
 #ifndef CONSTEXPR
@@ -72,6 +96,17 @@ namespace vdf
 {
 namespace detail
 {
+/// throws e, or aborts if exceptions are disabled
+template <typename E> [[noreturn]] void raise(const E &e)
+{
+#ifdef TYTI_VDF_EXCEPTIONS
+    throw e;
+#else
+    (void)e;
+    std::abort();
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //  Helper functions selecting the right encoding (char/wchar_T)
 ///////////////////////////////////////////////////////////////////////////
@@ -103,27 +138,6 @@ template <> struct literal_macro_help<wchar_t>
 #define TYTI_L(type, text)                                                     \
     vdf::detail::literal_macro_help<type>::result(text, L##text)
 
-inline std::string string_converter(const std::string &w) NOEXCEPT { return w; }
-
-inline std::string string_converter(const std::wstring &w) NOEXCEPT
-{
-    std::mbstate_t state = std::mbstate_t();
-    auto wstr = w.data();
-// unsafe: ignores any error handling
-// and disables warning that wcsrtombs_s should be used
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 4996)
-#endif
-    std::size_t len = 1 + std::wcsrtombs(nullptr, &wstr, 0, &state);
-    std::string mbstr(len, '\0');
-    std::wcsrtombs(&mbstr[0], &wstr, mbstr.size(), &state);
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
-    return mbstr;
-}
-
 ///////////////////////////////////////////////////////////////////////////
 //  Writer helper functions
 ///////////////////////////////////////////////////////////////////////////
@@ -142,6 +156,7 @@ template <typename charT> class tabs
     {
         return tabs(t + i);
     }
+    inline CONSTEXPR size_t count() const NOEXCEPT { return t; }
 };
 
 template <typename oStreamT>
@@ -151,23 +166,579 @@ oStreamT &operator<<(oStreamT &s, const tabs<typename oStreamT::char_type> t)
     return s;
 }
 
+/// position of the first '"' or '\\' in s, or n if there is none
+template <typename charT>
+size_t find_escape(const charT *s, size_t n) NOEXCEPT
+{
+    for (size_t i = 0; i < n; ++i)
+        if (s[i] == TYTI_L(charT, '"') || s[i] == TYTI_L(charT, '\\'))
+            return i;
+    return n;
+}
+
+#ifdef TYTI_VDF_SSE2
+/// index of the lowest set bit, mask must not be 0
+inline unsigned lowest_bit(unsigned mask) NOEXCEPT
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline size_t find_escape(const char *s, size_t n) NOEXCEPT
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+            return i + lowest_bit(static_cast<unsigned>(mask));
+    }
+    for (; i < n; ++i)
+        if (s[i] == '"' || s[i] == '\\')
+            return i;
+    return n;
+}
+#endif
+
+/// number of '\n' in [s, s + n)
 template <typename charT>
-std::basic_string<charT> escape(std::basic_string<charT> in)
+size_t count_newlines(const charT *s, size_t n) NOEXCEPT
 {
-    // std::replace_if(in.begin(), end.begin(), [](const charT))
-    for (size_t i = 0; i < in.size(); ++i)
+    return static_cast<size_t>(std::count(s, s + n, TYTI_L(charT, '\n')));
+}
+
+#ifdef TYTI_VDF_SSE2
+inline size_t count_newlines(const char *s, size_t n) NOEXCEPT
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    while (i + 16 <= n)
     {
-        if (in[i] == TYTI_L(charT, '\"') || in[i] == TYTI_L(charT, '\\'))
+        // every byte of acc counts the matches of its lane, it must not
+        // overflow
+        __m128i acc = _mm_setzero_si128();
+        const size_t blocks = std::min<size_t>((n - i) / 16, 255);
+        for (size_t b = 0; b < blocks; ++b, i += 16)
         {
-            in.insert(i, TYTI_L(charT, "\\"));
-            ++i;
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(chunk, newline));
         }
+        const __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+                 static_cast<size_t>(_mm_extract_epi16(sums, 4));
+    }
+    for (; i < n; ++i)
+        count += s[i] == '\n';
+    return count;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+//  UTF transcoding
+///////////////////////////////////////////////////////////////////////////
+
+/// writes the UTF-8 encoding of the code point c to out, returns the end
+inline char *encode_utf8(char32_t c, char *out) NOEXCEPT
+{
+    if (c < 0x80)
+    {
+        *out++ = static_cast<char>(c);
+    }
+    else if (c < 0x800)
+    {
+        *out++ = static_cast<char>(0xC0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+        *out++ = static_cast<char>(0xE0 | (c >> 12));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0 | (c >> 18));
+        *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
     }
-    return in;
+    return out;
+}
+
+/// code unit i of UTF-16 text stored as bytes
+inline char32_t utf16_unit(const unsigned char *s, size_t i,
+                           bool big_endian) NOEXCEPT
+{
+    const char32_t lo = s[2 * i + (big_endian ? 1 : 0)];
+    const char32_t hi = s[2 * i + (big_endian ? 0 : 1)];
+    return lo | (hi << 8);
+}
+
+/** \brief appends the UTF-8 encoding of n UTF-16 code units to out. The units
+are stored as bytes at s, in little or big endian order. Unpaired surrogates
+become U+FFFD. Runs of ASCII characters are converted 16 units at a time.
+*/
+inline void utf16_to_utf8(const unsigned char *s, size_t n, bool big_endian,
+                          std::string &out)
+{
+    // a unit takes at most 3 bytes, surrogate pairs take 4 for 2 units
+    const size_t old_size = out.size();
+    out.resize(old_size + 3 * n);
+    char *o = &out[0] + old_size;
+    size_t i = 0;
+    while (i < n)
+    {
+#ifdef TYTI_VDF_SSE2
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i a = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(s + 2 * i));
+            __m128i b = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(s + 2 * i + 16));
+            if (big_endian)
+            {
+                a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+                b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+            }
+            const __m128i high =
+                _mm_and_si128(_mm_or_si128(a, b), non_ascii);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) !=
+                0xFFFF)
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o),
+                             _mm_packus_epi16(a, b));
+            o += 16;
+        }
+        if (i == n)
+            break;
+#endif
+        const char32_t c = utf16_unit(s, i++, big_endian);
+        if (c < 0xD800 || c > 0xDFFF)
+        {
+            o = encode_utf8(c, o);
+        }
+        else if (c < 0xDC00 && i < n &&
+                 (utf16_unit(s, i, big_endian) & 0xFC00) == 0xDC00)
+        {
+            const char32_t low = utf16_unit(s, i++, big_endian);
+            o = encode_utf8(0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00),
+                            o);
+        }
+        else
+        {
+            o = encode_utf8(0xFFFD, o);
+        }
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+}
+
+/** \brief UTF-8 encoding of UTF-16 text in [first, last), given as bytes. A
+byte order mark selects little or big endian and is skipped, without one,
+little endian is assumed. A trailing odd byte becomes U+FFFD.
+*/
+inline std::string utf16_bytes_to_utf8(const char *first, const char *last)
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(first);
+    size_t size = static_cast<size_t>(last - first);
+    bool big_endian = false;
+    if (size >= 2 && ((s[0] == 0xFF && s[1] == 0xFE) ||
+                      (s[0] == 0xFE && s[1] == 0xFF)))
+    {
+        big_endian = s[0] == 0xFE;
+        s += 2;
+        size -= 2;
+    }
+    std::string out;
+    utf16_to_utf8(s, size / 2, big_endian, out);
+    if (size % 2 != 0)
+        out.append("\xEF\xBF\xBD");
+    return out;
+}
+
+/// byte order of char16_t and wchar_t in memory
+inline CONSTEXPR bool native_big_endian() NOEXCEPT
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) &&                \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// appends the UTF-8 encoding of n UTF-32 code units to out. Surrogates and
+/// values above U+10FFFF become U+FFFD
+template <typename UnitT>
+void utf32_to_utf8(const UnitT *s, size_t n, std::string &out)
+{
+    const size_t old_size = out.size();
+    out.resize(old_size + 4 * n);
+    char *o = &out[0] + old_size;
+    size_t i = 0;
+    while (i < n)
+    {
+#ifdef TYTI_VDF_SSE2
+        const __m128i non_ascii =
+            _mm_set1_epi32(static_cast<int>(0xFFFFFF80u));
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i *p = reinterpret_cast<const __m128i *>(s + i);
+            const __m128i a = _mm_loadu_si128(p);
+            const __m128i b = _mm_loadu_si128(p + 1);
+            const __m128i c = _mm_loadu_si128(p + 2);
+            const __m128i d = _mm_loadu_si128(p + 3);
+            const __m128i high = _mm_and_si128(
+                _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                non_ascii);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) !=
+                0xFFFF)
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o),
+                             _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                              _mm_packs_epi32(c, d)));
+            o += 16;
+        }
+        if (i == n)
+            break;
+#endif
+        char32_t c = static_cast<char32_t>(s[i++]);
+        if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+            c = 0xFFFD;
+        o = encode_utf8(c, o);
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+}
+
+/// number of bytes of the UTF-8 sequence starting with the lead byte b, or 0
+/// if b cannot start a sequence
+inline size_t utf8_lead_length(unsigned char b) NOEXCEPT
+{
+    if (b < 0x80)
+        return 1;
+    if ((b & 0xE0) == 0xC0)
+        return 2;
+    if ((b & 0xF0) == 0xE0)
+        return 3;
+    if ((b & 0xF8) == 0xF0)
+        return 4;
+    return 0;
+}
+
+/// length of the valid UTF-8 sequence at s[i], or 0 if it is invalid
+inline size_t utf8_sequence_length(const unsigned char *s, size_t n,
+                                   size_t i) NOEXCEPT
+{
+    const unsigned char b = s[i];
+    if (b < 0x80)
+        return 1;
+    size_t len;
+    char32_t min;
+    if ((b & 0xE0) == 0xC0)
+    {
+        len = 2;
+        min = 0x80;
+    }
+    else if ((b & 0xF0) == 0xE0)
+    {
+        len = 3;
+        min = 0x800;
+    }
+    else if ((b & 0xF8) == 0xF0)
+    {
+        len = 4;
+        min = 0x10000;
+    }
+    else
+    {
+        return 0;
+    }
+    if (n - i < len)
+        return 0;
+    // the lead byte of a sequence of len bytes holds 7 - len bits
+    char32_t c = b & (0x7Fu >> len);
+    for (size_t k = 1; k < len; ++k)
+    {
+        if ((s[i + k] & 0xC0) != 0x80)
+            return 0;
+        c = (c << 6) | (s[i + k] & 0x3Fu);
+    }
+    // overlong encodings, surrogates and values out of range
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+        return 0;
+    return len;
+}
+
+/// decodes the UTF-8 sequence at s[i] and advances i behind it. Invalid
+/// sequences become U+FFFD and consume one byte
+inline char32_t decode_utf8(const unsigned char *s, size_t n,
+                            size_t &i) NOEXCEPT
+{
+    const size_t len = utf8_sequence_length(s, n, i);
+    if (len == 0)
+    {
+        ++i;
+        return 0xFFFD;
+    }
+    if (len == 1)
+        return s[i++];
+    char32_t c = s[i] & (0x7Fu >> len);
+    for (size_t k = 1; k < len; ++k)
+        c = (c << 6) | (s[i + k] & 0x3Fu);
+    i += len;
+    return c;
+}
+
+/// offset of the first invalid UTF-8 sequence in [first, first + n), or n.
+/// Runs of ASCII characters are skipped 16 at a time
+inline size_t find_invalid_utf8(const char *first, size_t n) NOEXCEPT
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(first);
+    size_t i = 0;
+    while (i < n)
+    {
+#ifdef TYTI_VDF_SSE2
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            if (_mm_movemask_epi8(chunk) != 0)
+                break;
+        }
+        if (i == n)
+            break;
+#endif
+        const size_t len = utf8_sequence_length(s, n, i);
+        if (len == 0)
+            return i;
+        i += len;
+    }
+    return n;
+}
+
+/// true for iterators over chars which are stored contiguously, so that
+/// find_invalid_utf8 can read them in place
+template <typename IterT>
+struct is_contiguous_chars
+    : std::integral_constant<
+          bool,
+          std::is_same<IterT, const char *>::value ||
+              std::is_same<IterT, char *>::value ||
+              std::is_same<IterT, std::string::const_iterator>::value ||
+              std::is_same<IterT, std::string::iterator>::value ||
+              std::is_same<IterT, std::vector<char>::const_iterator>::value ||
+              std::is_same<IterT, std::vector<char>::iterator>::value>
+{
+};
+
+/// offset of the first invalid UTF-8 sequence in [first, last), or the
+/// length of the range
+template <typename IterT>
+size_t find_invalid_utf8(IterT first, const IterT last, std::true_type)
+{
+    const size_t n = static_cast<size_t>(std::distance(first, last));
+    return n == 0 ? 0 : find_invalid_utf8(&*first, n);
+}
+
+template <typename IterT>
+size_t find_invalid_utf8(IterT first, const IterT last, std::false_type)
+{
+    size_t offset = 0;
+    while (first != last)
+    {
+        unsigned char seq[4];
+        size_t n = 0;
+        for (IterT i = first; i != last && n < 4; ++i)
+            seq[n++] = static_cast<unsigned char>(*i);
+        const size_t len = utf8_sequence_length(seq, n, 0);
+        if (len == 0)
+            return offset;
+        std::advance(first, len);
+        offset += len;
+    }
+    return offset;
+}
+
+/// appends the UTF-8 encoding of n Latin-1 characters to out
+inline void latin1_to_utf8(const char *first, size_t n, std::string &out)
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(first);
+    const size_t old_size = out.size();
+    out.resize(old_size + 2 * n);
+    char *o = &out[0] + old_size;
+    size_t i = 0;
+    while (i < n)
+    {
+#ifdef TYTI_VDF_SSE2
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            if (_mm_movemask_epi8(chunk) != 0)
+                break;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), chunk);
+            o += 16;
+        }
+        if (i == n)
+            break;
+#endif
+        o = encode_utf8(s[i++], o);
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+}
+
+#ifdef TYTI_VDF_SSE2
+/// stores 16 ASCII characters as 2 or 4 byte code units
+template <typename UnitT> void widen_ascii(__m128i chunk, UnitT *o) NOEXCEPT
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(chunk, zero);
+    const __m128i hi = _mm_unpackhi_epi8(chunk, zero);
+    __m128i *p = reinterpret_cast<__m128i *>(o);
+    if (sizeof(UnitT) == 2)
+    {
+        _mm_storeu_si128(p, lo);
+        _mm_storeu_si128(p + 1, hi);
+    }
+    else
+    {
+        _mm_storeu_si128(p, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(hi, zero));
+    }
+}
+#endif
+
+/** \brief appends UTF-8 text of n bytes to out, as UTF-16 for 2 byte code
+units and as UTF-32 otherwise. Invalid sequences become U+FFFD. Runs of ASCII
+characters are converted 16 at a time.
+*/
+template <typename UnitT>
+void utf8_to_units(const char *first, size_t n, std::basic_string<UnitT> &out)
+{
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(first);
+    // every code unit takes at least one byte
+    const size_t old_size = out.size();
+    out.resize(old_size + n);
+    UnitT *o = &out[0] + old_size;
+    size_t i = 0;
+    while (i < n)
+    {
+#ifdef TYTI_VDF_SSE2
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            if (_mm_movemask_epi8(chunk) != 0)
+                break;
+            widen_ascii(chunk, o);
+            o += 16;
+        }
+        if (i == n)
+            break;
+#endif
+        const char32_t c = decode_utf8(s, n, i);
+        if (sizeof(UnitT) == 2 && c >= 0x10000)
+        {
+            *o++ = static_cast<UnitT>(0xD800 + ((c - 0x10000) >> 10));
+            *o++ = static_cast<UnitT>(0xDC00 + ((c - 0x10000) & 0x3FF));
+        }
+        else
+        {
+            *o++ = static_cast<UnitT>(c);
+        }
+    }
+    out.resize(static_cast<size_t>(o - out.data()));
+}
+
+/// appends in to out with every '"' and '\\' escaped by a backslash
+template <typename charT>
+void append_escaped(std::basic_string<charT> &out,
+                    const std::basic_string<charT> &in)
+{
+    const charT *s = in.data();
+    const size_t n = in.size();
+    size_t begin = 0;
+    size_t pos = find_escape(s, n);
+    while (pos != n)
+    {
+        out.append(s + begin, pos - begin);
+        out += TYTI_L(charT, '\\');
+        out += s[pos];
+        begin = pos + 1;
+        pos = begin + find_escape(s + begin, n - begin);
+    }
+    out.append(s + begin, n - begin);
 }
 
 } // end namespace detail
 
+///////////////////////////////////////////////////////////////////////////
+//  UTF conversion
+//  independent of the locale. wchar_t strings are UTF-16 where wchar_t has
+//  2 bytes (Windows) and UTF-32 otherwise. Invalid sequences become U+FFFD
+///////////////////////////////////////////////////////////////////////////
+
+inline std::string to_utf8(const std::u16string &s)
+{
+    std::string out;
+    detail::utf16_to_utf8(reinterpret_cast<const unsigned char *>(s.data()),
+                          s.size(), detail::native_big_endian(), out);
+    return out;
+}
+
+inline std::string to_utf8(const std::u32string &s)
+{
+    std::string out;
+    detail::utf32_to_utf8(s.data(), s.size(), out);
+    return out;
+}
+
+inline std::string to_utf8(const std::wstring &s)
+{
+    std::string out;
+    if (sizeof(wchar_t) == 2)
+        detail::utf16_to_utf8(reinterpret_cast<const unsigned char *>(s.data()),
+                              s.size(), detail::native_big_endian(), out);
+    else
+        detail::utf32_to_utf8(s.data(), s.size(), out);
+    return out;
+}
+
+inline std::u16string to_utf16(const std::string &s)
+{
+    std::u16string out;
+    detail::utf8_to_units(s.data(), s.size(), out);
+    return out;
+}
+
+inline std::u32string to_utf32(const std::string &s)
+{
+    std::u32string out;
+    detail::utf8_to_units(s.data(), s.size(), out);
+    return out;
+}
+
+inline std::wstring to_wstring(const std::string &s)
+{
+    std::wstring out;
+    detail::utf8_to_units(s.data(), s.size(), out);
+    return out;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //  Interface
 ///////////////////////////////////////////////////////////////////////////
@@ -186,104 +757,622 @@ template <typename CharT> struct basic_object
     std::unordered_map<std::basic_string<char_type>,
                        std::shared_ptr<basic_object<char_type>>>
         childs;
+    /// hash of the whole subtree, independent of the order of attribs and
+    /// childs. Only set if Options::compute_hashes or by update_hashes()
+    std::uint64_t hash = 0;
 
     void add_attribute(std::basic_string<char_type> key,
                        std::basic_string<char_type> value)
     {
-        attribs.emplace(std::move(key), std::move(value));
+        attribs.emplace(std::move(key), std::move(value));
+    }
+    void add_child(std::unique_ptr<basic_object<char_type>> child)
+    {
+        std::shared_ptr<basic_object<char_type>> obj{child.release()};
+        childs.emplace(obj->name, obj);
+    }
+    void set_name(std::basic_string<char_type> n) { name = std::move(n); }
+};
+
+template <typename CharT> struct basic_multikey_object
+{
+    typedef CharT char_type;
+    std::basic_string<char_type> name;
+    std::unordered_multimap<std::basic_string<char_type>,
+                            std::basic_string<char_type>>
+        attribs;
+    std::unordered_multimap<std::basic_string<char_type>,
+                            std::shared_ptr<basic_multikey_object<char_type>>>
+        childs;
+    /// hash of the whole subtree. Values with the same key are hashed in
+    /// their order. Only set if Options::compute_hashes or by
+    /// update_hashes()
+    std::uint64_t hash = 0;
+
+    void add_attribute(std::basic_string<char_type> key,
+                       std::basic_string<char_type> value)
+    {
+        attribs.emplace(std::move(key), std::move(value));
+    }
+    void add_child(std::unique_ptr<basic_multikey_object<char_type>> child)
+    {
+        std::shared_ptr<basic_multikey_object<char_type>> obj{child.release()};
+        childs.emplace(obj->name, obj);
+    }
+    void set_name(std::basic_string<char_type> n) { name = std::move(n); }
+};
+
+typedef basic_object<char> object;
+typedef basic_object<wchar_t> wobject;
+typedef basic_multikey_object<char> multikey_object;
+typedef basic_multikey_object<wchar_t> wmultikey_object;
+
+/// options of the parser. A new option, which changes the parsed tree, has to
+/// be added to the key of the parse cache (detail::options_bits in
+/// vdf_cache.hpp), otherwise cached trees parsed with other options are used
+struct Options
+{
+    bool strip_escape_symbols;
+    bool ignore_all_platform_conditionals;
+    bool ignore_includes;
+    /// sets the hash member of every parsed object, so that subtrees can be
+    /// compared in O(1). Output types without a hash member are not hashed
+    bool compute_hashes;
+    /// instead of failing at the first error, the parser skips the broken
+    /// part, continues at the next key or closing brace and keeps everything
+    /// parsed so far. Unclosed objects are closed at the end of the text. The
+    /// errors can be collected with the read() overload taking diagnostics
+    bool recover_errors;
+    /// streams of char are read as UTF-8, UTF-8 with BOM, UTF-16 (detected by
+    /// its BOM or its zero bytes) or Latin-1 (if the text is not valid UTF-8)
+    /// and transcoded to UTF-8 while reading. Streams of wchar_t are read as
+    /// they are
+    bool detect_encoding;
+    /// fails with a parsing error at the first invalid UTF-8 sequence. The
+    /// text is validated by the parser while it reads it, not in a separate
+    /// pass. Wide text is not validated. With recover_errors, every invalid
+    /// sequence is reported and the key/value pair or the object whose key
+    /// holds it is skipped
+    bool validate_utf8;
+
+    Options()
+        : strip_escape_symbols(true), ignore_all_platform_conditionals(false),
+          ignore_includes(false), compute_hashes(false), recover_errors(false),
+          detect_encoding(false), validate_utf8(false)
+    {
+    }
+};
+
+/// error thrown by read(), if the text is malformed
+class parse_error : public std::runtime_error
+{
+  public:
+    parse_error(const char *what, size_t offset)
+        : std::runtime_error(what), offset_(offset)
+    {
+    }
+
+    /// number of characters in front of the error, from the begin of the
+    /// parsed text. For errors in files included via #include/#base, it is
+    /// relative to the included file
+    size_t offset() const NOEXCEPT { return offset_; }
+
+  private:
+    size_t offset_;
+};
+
+/// a parsing error, see Options::recover_errors
+struct diagnostic
+{
+    /// static string, the same as parse_error::what()
+    const char *message;
+    /// same as parse_error::offset()
+    size_t offset;
+};
+
+/// line and column of a character, both start at 1
+struct text_position
+{
+    size_t line = 1;
+    size_t column = 1;
+};
+
+/** \brief line and column of the character at offset in [first, last), e.g.
+of parse_error::offset(). The lines are counted on demand, so errors cost
+nothing on the success path. offset is limited to the size of the text.
+*/
+template <typename charT>
+text_position position_of(const charT *first, const charT *last,
+                          size_t offset) NOEXCEPT
+{
+    offset = std::min(offset, static_cast<size_t>(last - first));
+    text_position pos;
+    pos.line += detail::count_newlines(first, offset);
+    const charT *line_begin = first + offset;
+    while (line_begin != first && *(line_begin - 1) != TYTI_L(charT, '\n'))
+        --line_begin;
+    pos.column += static_cast<size_t>(first + offset - line_begin);
+    return pos;
+}
+
+template <typename charT>
+text_position position_of(const std::basic_string<charT> &text,
+                          size_t offset) NOEXCEPT
+{
+    return position_of(text.data(), text.data() + text.size(), offset);
+}
+
+namespace detail
+{
+/// finalizer of splitmix64
+inline std::uint64_t mix64(std::uint64_t x) NOEXCEPT
+{
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
+/// stable hash of the code units of s. The units are combined into 64 bit
+/// words, independent of the byte order of the platform
+template <typename charT>
+std::uint64_t hash_string(const std::basic_string<charT> &s) NOEXCEPT
+{
+    typedef typename std::make_unsigned<charT>::type unit;
+    const size_t per_word = sizeof(std::uint64_t) / sizeof(charT);
+    const size_t bits = 8 * sizeof(charT);
+    const size_t n = s.size();
+    std::uint64_t h = UINT64_C(0x9e3779b97f4a7c15) ^ n;
+    size_t i = 0;
+    while (i < n)
+    {
+        std::uint64_t w = 0;
+        for (size_t j = 0; j < per_word && i < n; ++j, ++i)
+            w |= static_cast<std::uint64_t>(static_cast<unit>(s[i]))
+                 << (j * bits % 64);
+        h = (h ^ mix64(w)) * UINT64_C(0xff51afd7ed558ccd);
+    }
+    return mix64(h);
+}
+
+/// hash of one entry of attribs or childs. index counts the preceding
+/// entries with the same key, so multikey objects are hashed in order
+inline std::uint64_t hash_entry(std::uint64_t key, std::uint64_t value,
+                                std::uint64_t index) NOEXCEPT
+{
+    return mix64(key ^ mix64(value + index * UINT64_C(0x9e3779b97f4a7c15)));
+}
+
+template <typename T> std::uint64_t hash_of(const std::shared_ptr<T> &child)
+{
+    return child ? child->hash : 0;
+}
+template <typename charT>
+std::uint64_t hash_of(const std::basic_string<charT> &value)
+{
+    return hash_string(value);
+}
+
+/// sum of the entry hashes of attribs or childs. The sum does not depend on
+/// the order of the keys, entries with the same key are adjacent
+template <typename MapT> std::uint64_t hash_entries(const MapT &map)
+{
+    std::uint64_t sum = 0;
+    std::uint64_t index = 0;
+    const typename MapT::key_type *prev = nullptr;
+    for (const auto &i : map)
+    {
+        index = prev && *prev == i.first ? index + 1 : 0;
+        prev = &i.first;
+        sum += hash_entry(hash_string(i.first), hash_of(i.second), index);
+    }
+    return sum;
+}
+
+/// the part of hash_entries(map), which the entries with the given key add
+template <typename MapT>
+std::uint64_t hash_entries(const MapT &map, const typename MapT::key_type &key)
+{
+    std::uint64_t sum = 0;
+    std::uint64_t index = 0;
+    const std::uint64_t key_hash = hash_string(key);
+    const auto same_key = map.equal_range(key);
+    for (auto it = same_key.first; it != same_key.second; ++it)
+        sum += hash_entry(key_hash, hash_of(it->second), index++);
+    return sum;
+}
+
+/// hash of an object from its name and the results of hash_entries for its
+/// attribs and childs
+template <typename charT>
+std::uint64_t hash_node(const std::basic_string<charT> &name,
+                        std::uint64_t attribs, std::uint64_t childs)
+{
+    std::uint64_t h = mix64(hash_string(name));
+    h = mix64(h + attribs);
+    return mix64(h ^ (childs + UINT64_C(0xc2b2ae3d27d4eb4f)));
+}
+
+/// hash of obj, from the hashes of its childs
+template <typename T> std::uint64_t hash_node(const T &obj)
+{
+    return hash_node(obj.name, hash_entries(obj.attribs),
+                     hash_entries(obj.childs));
+}
+
+template <typename T, typename = void> struct has_hash : std::false_type
+{
+};
+template <typename T>
+struct has_hash<T, decltype(void(std::declval<T &>().hash))> : std::true_type
+{
+};
+
+template <typename T> void update_hash(T &obj, std::true_type)
+{
+    obj.hash = hash_node(obj);
+}
+template <typename T> void update_hash(T &, std::false_type) {}
+
+/// sets the hash of obj, if T has a hash member. The childs need to be hashed
+/// already
+template <typename T> void update_hash(T &obj)
+{
+    update_hash(obj, has_hash<T>{});
+}
+} // namespace detail
+
+/** \brief recomputes the hashes of all objects in the tree, e.g. after it
+was modified. See Options::compute_hashes.
+*/
+template <typename T> void update_hashes(T &root)
+{
+    // post order, without recursion for deep trees
+    struct frame
+    {
+        T *obj;
+        bool childs_done;
+    };
+    std::stack<frame> open;
+    open.push(frame{&root, false});
+    while (!open.empty())
+    {
+        frame &f = open.top();
+        if (f.childs_done)
+        {
+            detail::update_hash(*f.obj);
+            open.pop();
+            continue;
+        }
+        f.childs_done = true;
+        T *obj = f.obj;
+        for (auto &i : obj->childs)
+            if (i.second)
+                open.push(frame{i.second.get(), false});
+    }
+}
+
+struct WriteOptions
+{
+    bool escape_symbols;
+    /// emits the minimal valid vdf: no indentation or newlines and tokens are
+    /// only quoted if necessary
+    bool compact;
+    WriteOptions() : escape_symbols(true), compact(false) {}
+};
+
+// forward decls
+// forward decl
+template <typename OutputT, typename iStreamT>
+OutputT read(iStreamT &inStream, const Options &opt = Options{});
+
+namespace detail
+{
+/// number of buffered characters after which the writer hands them over to
+/// the stream
+const size_t write_block_size = 1 << 16;
+
+template <typename charT>
+void append_string(std::basic_string<charT> &out,
+                   const std::basic_string<charT> &in,
+                   const WriteOptions &opts)
+{
+    if (opts.escape_symbols)
+        append_escaped(out, in);
+    else
+        out += in;
+}
+
+/// true, if the token can be written without quotes
+template <typename charT>
+bool is_unquoted_token(const std::basic_string<charT> &in) NOEXCEPT
+{
+    // a leading '/' starts a comment, a leading '[' a conditional
+    if (in.empty() || in[0] == TYTI_L(charT, '/') ||
+        in[0] == TYTI_L(charT, '['))
+        return false;
+    for (const charT c : in)
+    {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+            c == '\f' || c == '"' || c == '{' || c == '}' || c == '\\')
+            return false;
+    }
+    return true;
+}
+
+/// appends a token for the compact output. Unquoted tokens are terminated by
+/// a space, as the reader ends them at whitespaces only
+template <typename charT>
+void append_compact_token(std::basic_string<charT> &out,
+                          const std::basic_string<charT> &in,
+                          const WriteOptions &opts)
+{
+    if (is_unquoted_token(in))
+    {
+        out += in;
+        out += TYTI_L(charT, ' ');
+    }
+    else
+    {
+        out += TYTI_L(charT, '"');
+        append_string(out, in, opts);
+        out += TYTI_L(charT, '"');
+    }
+}
+
+/// appends the opening of an object with the given indentation
+template <typename charT>
+void append_begin_object(std::basic_string<charT> &out,
+                         const std::basic_string<charT> &name,
+                         const WriteOptions &opts, size_t tab)
+{
+    if (opts.compact)
+    {
+        append_compact_token(out, name, opts);
+        out += TYTI_L(charT, '{');
+        return;
+    }
+    out.append(tab, TYTI_L(charT, '\t'));
+    out += TYTI_L(charT, '"');
+    append_string(out, name, opts);
+    out += TYTI_L(charT, "\"\n");
+    out.append(tab, TYTI_L(charT, '\t'));
+    out += TYTI_L(charT, "{\n");
+}
+
+/// appends an attribute with the given indentation
+template <typename charT>
+void append_key_value(std::basic_string<charT> &out,
+                      const std::basic_string<charT> &key,
+                      const std::basic_string<charT> &value,
+                      const WriteOptions &opts, size_t tab)
+{
+    if (opts.compact)
+    {
+        append_compact_token(out, key, opts);
+        append_compact_token(out, value, opts);
+        return;
+    }
+    out.append(tab, TYTI_L(charT, '\t'));
+    out += TYTI_L(charT, '"');
+    append_string(out, key, opts);
+    out += TYTI_L(charT, "\"\t\t\"");
+    append_string(out, value, opts);
+    out += TYTI_L(charT, "\"\n");
+}
+
+/// appends the closing of an object with the given indentation
+template <typename charT>
+void append_end_object(std::basic_string<charT> &out, const WriteOptions &opts,
+                       size_t tab)
+{
+    if (opts.compact)
+    {
+        out += TYTI_L(charT, '}');
+        return;
+    }
+    out.append(tab, TYTI_L(charT, '\t'));
+    out += TYTI_L(charT, "}\n");
+}
+
+/// appends the object tree to out. flush(out) is called after every object
+/// and may empty the buffer.
+/// Uses an explicit stack instead of recursion, so the depth of the tree is
+/// only limited by the available memory
+template <typename charT, typename T, typename FlushF>
+void write_object(std::basic_string<charT> &out, const T &r,
+                  const WriteOptions &opts, size_t tab, FlushF &flush)
+{
+    typedef decltype(r.childs.begin()) child_iterator;
+    struct level
+    {
+        const T *obj;
+        child_iterator next_child;
+    };
+    std::stack<level> lvls;
+
+    auto open = [&](const T &obj)
+    {
+        const size_t depth = tab + lvls.size();
+        append_begin_object(out, obj.name, opts, depth);
+        for (const auto &i : obj.attribs)
+            append_key_value(out, i.first, i.second, opts, depth + 1);
+        lvls.push(level{&obj, obj.childs.begin()});
+    };
+
+    open(r);
+    while (!lvls.empty())
+    {
+        level &cur = lvls.top();
+        if (cur.next_child != cur.obj->childs.end())
+        {
+            const auto &child = (cur.next_child++)->second;
+            if (child)
+                open(*child);
+            continue;
+        }
+        lvls.pop();
+        append_end_object(out, opts, tab + lvls.size());
+        flush(out);
+    }
+}
+} // namespace detail
+
+/** \brief appends given object tree in vdf format to the given string.
+Output is prettyfied, using tabs, unless WriteOptions::compact is set
+*/
+template <typename charT, typename T>
+void write(std::basic_string<charT> &out, const T &r,
+           const WriteOptions &opts = {})
+{
+    auto no_flush = [](std::basic_string<charT> &) {};
+    detail::write_object(out, r, opts, 0, no_flush);
+}
+
+/** \brief writes given object tree in vdf format to given stream.
+Output is prettyfied, using tabs, unless WriteOptions::compact is set. The
+indentation given by tab is ignored in compact mode. The output is collected
+in a buffer and handed to the stream in large blocks.
+*/
+template <typename oStreamT, typename T>
+void write(oStreamT &s, const T &r, const WriteOptions &opts = {},
+           const detail::tabs<typename oStreamT::char_type> tab =
+               detail::tabs<typename oStreamT::char_type>(0))
+{
+    typedef typename oStreamT::char_type charT;
+    std::basic_string<charT> buffer;
+    buffer.reserve(detail::write_block_size);
+    auto flush = [&s](std::basic_string<charT> &buf)
+    {
+        if (buf.size() >= detail::write_block_size)
+        {
+            s.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            buf.clear();
+        }
+    };
+    detail::write_object(buffer, r, opts, tab.count(), flush);
+    s.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+/** \brief writes vdf data to a stream without building an object tree.
+Every call appends to an internal buffer, which is handed to the stream in
+large blocks, so the memory usage does not depend on the size of the output.
+Escaping, indentation and compact output follow the given WriteOptions.
+\code
+    tyti::vdf::writer w(file);
+    w.begin_object("root");
+    w.key_value("key", "value");
+    w.end_object();
+\endcode
+can throw:
+    - "std::logic_error" if the calls do not form a valid vdf structure
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+template <typename oStreamT> class basic_writer
+{
+  public:
+    typedef typename oStreamT::char_type char_type;
+    typedef std::basic_string<char_type> string_type;
+
+    explicit basic_writer(oStreamT &s, const WriteOptions &opts = {})
+        : s_(s), opts_(opts)
+    {
+        buffer_.reserve(detail::write_block_size);
+    }
+
+    basic_writer(const basic_writer &) = delete;
+    basic_writer &operator=(const basic_writer &) = delete;
+
+    /// hands the remaining output to the stream
+    ~basic_writer()
+    {
+#ifdef TYTI_VDF_EXCEPTIONS
+        try
+        {
+            flush();
+        }
+        catch (...)
+        {
+        }
+#else
+        flush();
+#endif
     }
-    void add_child(std::unique_ptr<basic_object<char_type>> child)
+
+    /// opens a new object, nested into the current one
+    basic_writer &begin_object(const string_type &name)
     {
-        std::shared_ptr<basic_object<char_type>> obj{child.release()};
-        childs.emplace(obj->name, obj);
+        detail::append_begin_object(buffer_, name, opts_, depth_);
+        ++depth_;
+        flush_full();
+        return *this;
     }
-    void set_name(std::basic_string<char_type> n) { name = std::move(n); }
-};
-
-template <typename CharT> struct basic_multikey_object
-{
-    typedef CharT char_type;
-    std::basic_string<char_type> name;
-    std::unordered_multimap<std::basic_string<char_type>,
-                            std::basic_string<char_type>>
-        attribs;
-    std::unordered_multimap<std::basic_string<char_type>,
-                            std::shared_ptr<basic_multikey_object<char_type>>>
-        childs;
 
-    void add_attribute(std::basic_string<char_type> key,
-                       std::basic_string<char_type> value)
+    /// adds an attribute to the current object
+    basic_writer &key_value(const string_type &key, const string_type &value)
     {
-        attribs.emplace(std::move(key), std::move(value));
+        if (depth_ == 0)
+            detail::raise(
+                std::logic_error("key_value called outside of an object"));
+        detail::append_key_value(buffer_, key, value, opts_, depth_);
+        flush_full();
+        return *this;
     }
-    void add_child(std::unique_ptr<basic_multikey_object<char_type>> child)
+
+    /// closes the current object
+    basic_writer &end_object()
     {
-        std::shared_ptr<basic_multikey_object<char_type>> obj{child.release()};
-        childs.emplace(obj->name, obj);
+        if (depth_ == 0)
+            detail::raise(
+                std::logic_error("end_object called without open object"));
+        --depth_;
+        detail::append_end_object(buffer_, opts_, depth_);
+        flush_full();
+        return *this;
     }
-    void set_name(std::basic_string<char_type> n) { name = std::move(n); }
-};
 
-typedef basic_object<char> object;
-typedef basic_object<wchar_t> wobject;
-typedef basic_multikey_object<char> multikey_object;
-typedef basic_multikey_object<wchar_t> wmultikey_object;
+    /// number of open objects
+    size_t depth() const NOEXCEPT { return depth_; }
 
-struct Options
-{
-    bool strip_escape_symbols;
-    bool ignore_all_platform_conditionals;
-    bool ignore_includes;
+    /// hands all buffered output to the stream
+    void flush()
+    {
+        s_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+        s_.flush();
+    }
 
-    Options()
-        : strip_escape_symbols(true), ignore_all_platform_conditionals(false),
-          ignore_includes(false)
+  private:
+    void flush_full()
     {
+        if (buffer_.size() >= detail::write_block_size)
+        {
+            s_.write(buffer_.data(),
+                     static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
     }
-};
 
-struct WriteOptions
-{
-    bool escape_symbols;
-    WriteOptions() : escape_symbols(true) {}
+    oStreamT &s_;
+    const WriteOptions opts_;
+    string_type buffer_;
+    size_t depth_ = 0;
 };
 
-// forward decls
-// forward decl
-template <typename OutputT, typename iStreamT>
-OutputT read(iStreamT &inStream, const Options &opt = Options{});
+typedef basic_writer<std::ostream> writer;
+typedef basic_writer<std::wostream> wwriter;
 
-/** \brief writes given object tree in vdf format to given stream.
-Output is prettyfied, using tabs
-*/
-template <typename oStreamT, typename T>
-void write(oStreamT &s, const T &r, const WriteOptions &opts = {},
-           const detail::tabs<typename oStreamT::char_type> tab =
-               detail::tabs<typename oStreamT::char_type>(0))
+namespace detail
 {
-    typedef typename oStreamT::char_type charT;
-    using namespace detail;
-    auto escapeFunction = [&opts](const std::basic_string<charT> &in)
-    {
-        if (opts.escape_symbols)
-            return escape(std::move(in));
-        return in;
-    };
+/// narrow file name of a string, wide strings are converted to UTF-8
+inline std::string string_converter(const std::string &w) { return w; }
 
-    s << tab << TYTI_L(charT, '"') << escapeFunction(r.name)
-      << TYTI_L(charT, "\"\n") << tab << TYTI_L(charT, "{\n");
-    for (const auto &i : r.attribs)
-        s << tab + 1 << TYTI_L(charT, '"') << escapeFunction(i.first)
-          << TYTI_L(charT, "\"\t\t\"") << escapeFunction(i.second)
-          << TYTI_L(charT, "\"\n");
-    for (const auto &i : r.childs)
-        if (i.second)
-            write(s, *i.second, opts, tab + 1);
-    s << tab << TYTI_L(charT, "}\n");
+inline std::string string_converter(const std::wstring &w)
+{
+    return to_utf8(w);
 }
 
-namespace detail
-{
 template <typename iStreamT>
 std::basic_string<typename iStreamT::char_type> read_file(iStreamT &inStream)
 {
@@ -300,24 +1389,171 @@ std::basic_string<typename iStreamT::char_type> read_file(iStreamT &inStream)
     return str;
 }
 
+/// reads a stream completely, see Options::detect_encoding
+template <typename charT>
+std::basic_string<charT> read_text(std::basic_istream<charT> &inStream,
+                                   const Options &)
+{
+    return read_file(inStream);
+}
+
+/** \brief reads a stream of bytes completely. With Options::detect_encoding,
+the encoding is detected from the first block and UTF-16 is transcoded to
+UTF-8 block by block, so that only the UTF-8 text is kept in memory. 8 bit
+text, which is not valid UTF-8, is converted from Latin-1.
+*/
+inline std::string read_text(std::istream &inStream, const Options &opt)
+{
+    if (!opt.detect_encoding)
+        return read_file(inStream);
+
+    const size_t block_size = size_t{1} << 16;
+    inStream.seekg(0, std::ios::end);
+    const auto end = inStream.tellg();
+    inStream.seekg(0, std::ios::beg);
+    size_t left = end > 0 ? static_cast<size_t>(end) : 0;
+    auto append_block = [&inStream, &left, block_size](std::string &s)
+    {
+        const size_t n = std::min(left, block_size);
+        const size_t old_size = s.size();
+        s.resize(old_size + n);
+        if (n != 0)
+            inStream.read(&s[old_size], static_cast<std::streamsize>(n));
+        left -= n;
+    };
+
+    std::string block;
+    append_block(block);
+    const unsigned char *b =
+        reinterpret_cast<const unsigned char *>(block.data());
+    const size_t size = block.size();
+    bool utf16 = false;
+    bool big_endian = false;
+    size_t bom = 0;
+    if (size >= 3 && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF)
+    {
+        bom = 3;
+    }
+    else if (size >= 2 && ((b[0] == 0xFF && b[1] == 0xFE) ||
+                           (b[0] == 0xFE && b[1] == 0xFF)))
+    {
+        utf16 = true;
+        big_endian = b[0] == 0xFE;
+        bom = 2;
+    }
+    else
+    {
+        // ASCII characters in UTF-16 have a zero byte, 8 bit text has none
+        size_t zeros[2] = {0, 0};
+        for (size_t i = 0; i < size; ++i)
+            zeros[i % 2] += b[i] == 0 ? 1 : 0;
+        utf16 = std::max(zeros[0], zeros[1]) > size / 8;
+        big_endian = zeros[0] > zeros[1];
+    }
+
+    if (!utf16)
+    {
+        // the rest is read behind the first block
+        while (left != 0)
+            append_block(block);
+        block.erase(0, bom);
+        if (bom != 0 || find_invalid_utf8(block.data(), block.size()) ==
+                            block.size())
+            return block;
+        std::string out;
+        latin1_to_utf8(block.data(), block.size(), out);
+        return out;
+    }
+
+    // ASCII text takes half of the size in UTF-8
+    std::string out;
+    out.reserve((left + size) / 2 + 2 * block_size);
+    block.erase(0, bom);
+    for (;;)
+    {
+        const unsigned char *s =
+            reinterpret_cast<const unsigned char *>(block.data());
+        size_t units = block.size() / 2;
+        // a high surrogate waits for its pair in the next block
+        if (left != 0 && units != 0 &&
+            (utf16_unit(s, units - 1, big_endian) & 0xFC00) == 0xD800)
+            --units;
+        utf16_to_utf8(s, units, big_endian, out);
+        block.erase(0, 2 * units);
+        if (left == 0)
+            break;
+        append_block(block);
+    }
+    if (!block.empty())
+        out.append("\xEF\xBF\xBD");
+    return out;
+}
+
+/// true, if the platform name of a conditional, e.g. "$WIN32", matches the
+/// current platform
+template <typename charT>
+bool is_platform_str(const std::basic_string<charT> &in)
+{
+#ifdef WIN32
+    return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$WINDOWS");
+#elif __APPLE__
+    // WIN32 stands for pc in general
+    return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$POSIX") ||
+           in == TYTI_L(charT, "$OSX");
+#elif __linux__
+    // WIN32 stands for pc in general
+    return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$POSIX") ||
+           in == TYTI_L(charT, "$LINUX");
+#else
+    (void)in;
+    return false;
+#endif
+}
+
+/// evaluates a conditional without its brackets, e.g. "!$OSX"
+template <typename charT>
+bool conditional_fulfilled(const std::basic_string<charT> &conditional,
+                           const Options &opt)
+{
+    const bool negate = !conditional.empty() && conditional[0] == '!';
+    const bool is_platform =
+        !opt.ignore_all_platform_conditionals &&
+        is_platform_str(conditional.substr(negate ? 1 : 0));
+    return is_platform ^ negate;
+}
+
+/// the parsed value or the first parsing error, so that the parser can fail
+/// without exceptions
+template <typename T> struct parse_result
+{
+    T value{};
+    /// static message of the error, null on success
+    const char *error = nullptr;
+    size_t offset = 0;
+
+    explicit operator bool() const NOEXCEPT { return error == nullptr; }
+};
+
 /** \brief Read VDF formatted sequences defined by the range [first, last).
 If the file is mailformatted, parser will try to read it until it can.
 @param first            begin iterator
 @param end              end iterator
 @param exclude_files    list of files which cant be included anymore.
                         prevents circular includes
+@param diagnostics      collects the errors, may be null
 
+Parsing errors are returned, not thrown. With Options::recover_errors, the
+parser continues after them and the result never holds an error.
 can thow:
-        - "std::runtime_error" if a parsing error occured
         - "std::bad_alloc" if not enough memory coup be allocated
 */
 template <typename OutputT, typename IterT>
-std::vector<std::unique_ptr<OutputT>> read_internal(
+parse_result<std::vector<std::unique_ptr<OutputT>>> read_internal(
     IterT first, const IterT last,
     std::unordered_set<
         std::basic_string<typename std::iterator_traits<IterT>::value_type>>
         &exclude_files,
-    const Options &opt)
+    std::vector<diagnostic> *diagnostics, const Options &opt)
 {
     static_assert(std::is_default_constructible<OutputT>::value,
                   "Output Type must be default constructible (provide "
@@ -329,38 +1565,31 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
 
     const std::basic_string<charT> comment_end_str = TYTI_L(charT, "*/");
 
-#ifdef WIN32
-    std::function<bool(const std::basic_string<charT> &)> is_platform_str =
-        [](const std::basic_string<charT> &in)
-    {
-        return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$WINDOWS");
-    };
-#elif __APPLE__
-    // WIN32 stands for pc in general
-    std::function<bool(const std::basic_string<charT> &)> is_platform_str =
-        [](const std::basic_string<charT> &in)
-    {
-        return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$POSIX") ||
-               in == TYTI_L(charT, "$OSX");
-    };
-
-#elif __linux__
-    // WIN32 stands for pc in general
-    std::function<bool(const std::basic_string<charT> &)> is_platform_str =
-        [](const std::basic_string<charT> &in)
-    {
-        return in == TYTI_L(charT, "$WIN32") || in == TYTI_L(charT, "$POSIX") ||
-               in == TYTI_L(charT, "$LINUX");
-    };
-#else
     std::function<bool(const std::basic_string<charT> &)> is_platform_str =
-        [](const std::basic_string<charT> &in) { return false; };
-#endif
+        detail::is_platform_str<charT>;
 
     if (opt.ignore_all_platform_conditionals)
         is_platform_str = [](const std::basic_string<charT> &)
         { return false; };
 
+    parse_result<std::vector<std::unique_ptr<OutputT>>> result;
+
+    // errors carry the offset of pos, line and column are only computed on
+    // demand, see position_of. Returns true in recovery mode, then the caller
+    // resynchronizes. Otherwise, the caller stops parsing
+    auto report = [&first, &opt, diagnostics, &result](const char *what,
+                                                       const IterT &pos)
+    {
+        const auto offset = static_cast<size_t>(std::distance(first, pos));
+        if (diagnostics)
+            diagnostics->push_back(diagnostic{what, offset});
+        if (opt.recover_errors)
+            return true;
+        result.error = what;
+        result.offset = offset;
+        return false;
+    };
+
     // function for skipping a comment block
     // iter: iterator poition to the position after a '/'
     auto skip_comments = [&comment_end_str](IterT iter,
@@ -391,12 +1620,16 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
         return iter;
     };
 
-    auto end_quote = [opt](IterT iter, const IterT &last) -> IterT
+    // returns last for unclosed quotes and words
+    auto end_quote = [opt, &report](IterT iter, const IterT &last) -> IterT
     {
         const auto begin = iter;
         auto last_esc = iter;
         if (iter == last)
-            throw std::runtime_error{"quote was opened but not closed."};
+        {
+            report("quote was opened but not closed.", begin);
+            return last;
+        }
         do
         {
             ++iter;
@@ -412,7 +1645,7 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
             }
         } while (!(std::distance(last_esc, iter) % 2) && iter != last);
         if (iter == last)
-            throw std::runtime_error{"quote was opened but not closed."};
+            report("quote was opened but not closed.", begin);
         return iter;
     };
 
@@ -422,12 +1655,16 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
                 c == '\f');
     };
 
-    auto end_word = [is_whitespace](IterT iter, const IterT &last) -> IterT
+    auto end_word = [is_whitespace, &report](IterT iter,
+                                             const IterT &last) -> IterT
     {
         const auto begin = iter;
         auto last_esc = iter;
         if (iter == last)
-            throw std::runtime_error{"quote was opened but not closed."};
+        {
+            report("quote was opened but not closed.", begin);
+            return last;
+        }
         do
         {
             ++iter;
@@ -441,7 +1678,7 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
                 --last_esc;
         } while (!(std::distance(last_esc, iter) % 2) && iter != last);
         if (iter == last)
-            throw std::runtime_error{"word wasnt properly ended"};
+            report("word wasnt properly ended", begin);
         return iter;
     };
 
@@ -485,8 +1722,11 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
         return s;
     };
 
+    // unclosed conditionals are not fullfilled, they consume the rest of the
+    // text
     auto conditional_fullfilled =
-        [&skip_whitespaces, &is_platform_str](IterT &iter, const IterT &last)
+        [&skip_whitespaces, &is_platform_str, &report](IterT &iter,
+                                                   const IterT &last)
     {
         iter = skip_whitespaces(iter, last);
         if (iter == last)
@@ -495,11 +1735,13 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
             return true;
         ++iter;
 
-        if (iter == last)
-            throw std::runtime_error("conditional not closed");
         const auto end = std::find(iter, last, ']');
         if (end == last)
-            throw std::runtime_error("conditional not closed");
+        {
+            report("conditional not closed", iter);
+            iter = last;
+            return false;
+        }
         const bool negate = *iter == '!';
         if (negate)
             ++iter;
@@ -509,15 +1751,106 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
         return static_cast<bool>(is_platform ^ negate);
     };
 
+    // the text is validated block by block, just ahead of the tokenizer, so
+    // that both read a block while it is in the cache. A sequence which is
+    // cut by the end of a block is carried into the next one, which starts
+    // at its lead byte
+    const bool validate = opt.validate_utf8 && sizeof(charT) == 1;
+    auto validated = first;
+    // in recovery mode, the begin of every invalid sequence ahead of the
+    // tokenizer
+    std::deque<IterT> invalid_at;
+    auto validate_utf8 = [&validated, &last, &report,
+                          &invalid_at](const IterT &pos)
+    {
+        typedef typename std::iterator_traits<IterT>::difference_type diff_t;
+        const diff_t block_size = 4096;
+        auto is_continuation = [](charT c)
+        { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; };
+        while (validated != last && !(pos < validated))
+        {
+            const auto end = validated + std::min(block_size, last - validated);
+            const size_t n = static_cast<size_t>(std::distance(validated, end));
+            const size_t invalid = find_invalid_utf8(
+                validated, end, detail::is_contiguous_chars<IterT>{});
+            if (invalid == n)
+            {
+                validated = end;
+                continue;
+            }
+            const auto at = validated + static_cast<diff_t>(invalid);
+            // the carried sequence: its lead byte needs more bytes than the
+            // block has left, and the bytes it has are continuation bytes
+            const size_t needed =
+                detail::utf8_lead_length(static_cast<unsigned char>(*at));
+            const bool carried = end != last && invalid != 0 &&
+                                 invalid + needed > n &&
+                                 std::all_of(std::next(at), end, is_continuation);
+            validated = at;
+            if (carried)
+                continue;
+            if (!report("invalid UTF-8 sequence", validated))
+                return false;
+            invalid_at.push_back(validated);
+            // one error per broken sequence
+            do
+                ++validated;
+            while (validated != last && is_continuation(*validated));
+        }
+        return true;
+    };
+
+    // in recovery mode, whether [begin, end) holds an invalid sequence. The
+    // tokens are checked in the order of the text
+    auto holds_invalid = [&](const IterT &begin, const IterT &end)
+    {
+        if (!validate || !opt.recover_errors)
+            return false;
+        validate_utf8(end);
+        while (!invalid_at.empty() && invalid_at.front() < begin)
+            invalid_at.pop_front();
+        return !invalid_at.empty() && invalid_at.front() < end;
+    };
+
     // read header
     //  first, quoted name
     std::unique_ptr<OutputT> curObj = nullptr;
     std::vector<std::unique_ptr<OutputT>> roots;
     std::stack<std::unique_ptr<OutputT>> lvls;
+    // for curObj and every object in lvls, whether it is parsed but not kept
+    std::vector<bool> dropped;
     auto curIter = first;
 
+    auto close_object = [&]()
+    {
+        const bool drop = dropped.back();
+        dropped.pop_back();
+        // the childs are complete at this point
+        if (opt.compute_hashes && !drop)
+            detail::update_hash(*curObj);
+        if (!lvls.empty())
+        {
+            // get object before
+            std::unique_ptr<OutputT> prev{std::move(lvls.top())};
+            lvls.pop();
+
+            // add finished obj to obj before and release it from processing
+            if (!drop)
+                prev->add_child(std::move(curObj));
+            curObj = std::move(prev);
+        }
+        else
+        {
+            if (!drop)
+                roots.push_back(std::move(curObj));
+            curObj.reset();
+        }
+    };
+
     while (curIter != last && *curIter != '\0')
     {
+        if (validate && !validate_utf8(curIter))
+            break;
         //  find first starting attrib/child, or ending
         curIter = skip_whitespaces(curIter, last);
         if (curIter == last || *curIter == '\0')
@@ -526,52 +1859,67 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
         {
             curIter = skip_comments(curIter, last);
             if (curIter == last || *curIter == '\0')
-                throw std::runtime_error("Unexpected eof");
+            {
+                report("Unexpected eof", curIter);
+                break;
+            }
         }
         else if (*curIter != TYTI_L(charT, '}'))
         {
             // get key
+            const auto keyBegin = curIter;
             const auto keyEnd = (*curIter == TYTI_L(charT, '\"'))
                                     ? end_quote(curIter, last)
                                     : end_word(curIter, last);
+            // unclosed, nothing is left to parse
+            if (keyEnd == last)
+                break;
             if (*curIter == TYTI_L(charT, '\"'))
                 ++curIter;
             std::basic_string<charT> key(curIter, keyEnd);
             curIter = keyEnd + ((*keyEnd == TYTI_L(charT, '\"')) ? 1 : 0);
             if (curIter == last)
-                throw std::runtime_error{"key opened, but never closed"};
+            {
+                report("key opened, but never closed", curIter);
+                break;
+            }
 
             curIter = skip_whitespaces(curIter, last);
 
             if (!conditional_fullfilled(curIter, last))
                 continue;
             if (curIter == last)
-                throw std::runtime_error{"key declared, but no value"};
-
-            while (*curIter == TYTI_L(charT, '/'))
             {
+                report("key declared, but no value", curIter);
+                break;
+            }
 
+            // in recovery mode, the key is dropped and the parser continues
+            // with the '}' or the end of the text
+            bool no_value = false;
+            while (!no_value && *curIter == TYTI_L(charT, '/'))
+            {
                 curIter = skip_comments(curIter, last);
-                if (curIter == last || *curIter == '}')
-                    throw std::runtime_error{"key declared, but no value"};
-                curIter = skip_whitespaces(curIter, last);
-                if (curIter == last || *curIter == '}')
-                    throw std::runtime_error{"key declared, but no value"};
+                if (curIter != last && *curIter != '}')
+                    curIter = skip_whitespaces(curIter, last);
+                no_value = curIter == last || *curIter == '}';
+            }
+            if (no_value)
+            {
+                if (!report("key declared, but no value", curIter))
+                    break;
+                continue;
             }
             // get value
             if (*curIter != '{')
             {
-                if (curIter == last)
-                    throw std::runtime_error{"key declared, but no value"};
                 const auto valueEnd = (*curIter == TYTI_L(charT, '\"'))
                                           ? end_quote(curIter, last)
                                           : end_word(curIter, last);
                 if (valueEnd == last)
-                    throw std::runtime_error("No closed word");
+                    break;
                 if (*curIter == TYTI_L(charT, '\"'))
                     ++curIter;
-                if (curIter == last)
-                    throw std::runtime_error("No closed word");
 
                 auto value = std::basic_string<charT>(curIter, valueEnd);
 
@@ -580,6 +1928,8 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
 
                 if (!conditional_fullfilled(curIter, last))
                     continue;
+                if (holds_invalid(keyBegin, valueEnd))
+                    continue;
 
                 // process value
                 if (key != TYTI_L(charT, "#include") &&
@@ -591,10 +1941,10 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
                             strip_escape_symbols(std::move(key)),
                             strip_escape_symbols(std::move(value)));
                     }
-                    else
+                    else if (!report("unexpected key without object",
+                                     curIter))
                     {
-                        throw std::runtime_error{
-                            "unexpected key without object"};
+                        break;
                     }
                 }
                 else
@@ -605,10 +1955,13 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
                         exclude_files.insert(value);
                         std::basic_ifstream<charT> i(
                             detail::string_converter(value));
-                        auto str = read_file(i);
+                        auto str = read_text(i, opt);
                         auto file_objs = read_internal<OutputT>(
-                            str.begin(), str.end(), exclude_files, opt);
-                        for (auto &n : file_objs)
+                            str.begin(), str.end(), exclude_files, diagnostics,
+                            opt);
+                        if (!file_objs)
+                            return file_objs;
+                        for (auto &n : file_objs.value)
                         {
                             if (curObj)
                                 curObj->add_child(std::move(n));
@@ -623,6 +1976,7 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
             {
                 if (curObj)
                     lvls.push(std::move(curObj));
+                dropped.push_back(holds_invalid(keyBegin, keyEnd));
                 curObj = std::make_unique<OutputT>();
                 curObj->set_name(strip_escape_symbols(std::move(key)));
                 ++curIter;
@@ -631,34 +1985,58 @@ std::vector<std::unique_ptr<OutputT>> read_internal(
         // end of new object
         else if (curObj && *curIter == TYTI_L(charT, '}'))
         {
-            if (!lvls.empty())
-            {
-                // get object before
-                std::unique_ptr<OutputT> prev{std::move(lvls.top())};
-                lvls.pop();
-
-                // add finished obj to obj before and release it from processing
-                prev->add_child(std::move(curObj));
-                curObj = std::move(prev);
-            }
-            else
-            {
-                roots.push_back(std::move(curObj));
-                curObj.reset();
-            }
+            close_object();
             ++curIter;
         }
         else
         {
-            throw std::runtime_error{"unexpected '}'"};
+            if (!report("unexpected '}'", curIter))
+                break;
+            ++curIter;
         }
     }
+    if (!result)
+        return result;
+    if (validate && !validate_utf8(curIter))
+        return result;
     if (curObj != nullptr || !lvls.empty())
     {
-        throw std::runtime_error{"object is not closed with '}'"};
+        if (!report("object is not closed with '}'", curIter))
+            return result;
+        // keep what was parsed so far
+        while (curObj)
+            close_object();
+    }
+
+    result.value = std::move(roots);
+    return result;
+}
+
+/// read() with optional diagnostics, without throwing parsing errors
+template <typename OutputT, typename IterT>
+parse_result<OutputT> read_root(IterT first, const IterT last,
+                                std::vector<diagnostic> *diagnostics,
+                                const Options &opt)
+{
+    auto exclude_files = std::unordered_set<
+        std::basic_string<typename std::iterator_traits<IterT>::value_type>>{};
+    auto roots = detail::read_internal<OutputT>(first, last, exclude_files,
+                                                diagnostics, opt);
+
+    parse_result<OutputT> result;
+    result.error = roots.error;
+    result.offset = roots.offset;
+    if (roots.value.size() > 1)
+    {
+        for (auto &i : roots.value)
+            result.value.add_child(std::move(i));
+        if (opt.compute_hashes)
+            detail::update_hash(result.value);
     }
+    else if (roots.value.size() == 1)
+        result.value = std::move(*roots.value[0]);
 
-    return roots;
+    return result;
 }
 
 } // namespace detail
@@ -669,27 +2047,34 @@ If the file is mailformatted, parser will try to read it until it can.
 @param end end iterator
 
 can thow:
-        - "std::runtime_error" if a parsing error occured
+        - "parse_error" if a parsing error occured, it carries the offset
         - "std::bad_alloc" if not enough memory coup be allocated
 */
 template <typename OutputT, typename IterT>
 OutputT read(IterT first, const IterT last, const Options &opt = Options{})
 {
-    auto exclude_files = std::unordered_set<
-        std::basic_string<typename std::iterator_traits<IterT>::value_type>>{};
-    auto roots =
-        detail::read_internal<OutputT>(first, last, exclude_files, opt);
-
-    OutputT result;
-    if (roots.size() > 1)
-    {
-        for (auto &i : roots)
-            result.add_child(std::move(i));
-    }
-    else if (roots.size() == 1)
-        result = std::move(*roots[0]);
+    auto r = detail::read_root<OutputT>(first, last, nullptr, opt);
+    if (!r)
+        detail::raise(parse_error(r.error, r.offset));
+    return std::move(r.value);
+}
 
-    return result;
+/** \brief same as read(), but parsing errors are appended to diagnostics
+instead of thrown. With Options::recover_errors, the parser continues after
+each error and the result holds everything which could be parsed. Otherwise,
+it stops at the first error and the result is empty.
+can throw:
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+template <typename OutputT, typename IterT>
+OutputT read(IterT first, const IterT last,
+             std::vector<diagnostic> &diagnostics,
+             const Options &opt = Options{})
+{
+    auto r = detail::read_root<OutputT>(first, last, &diagnostics, opt);
+    if (!r)
+        return OutputT{};
+    return std::move(r.value);
 }
 
 /** \brief Read VDF formatted sequences defined by the range [first, last).
@@ -706,27 +2091,55 @@ std::errc::invalid_argument: iterators throws e.g. out of range
 template <typename OutputT, typename IterT>
 OutputT read(IterT first, IterT last, std::error_code &ec,
              const Options &opt = Options{}) NOEXCEPT
+{
+    size_t error_offset;
+    return read<OutputT>(first, last, ec, error_offset, opt);
+}
 
+/** \brief same as read() with an error code, but also reports the offset of
+parsing errors.
+@param error_offset set to parse_error::offset() for
+std::errc::protocol_error, see position_of() for line and column
+*/
+template <typename OutputT, typename IterT>
+OutputT read(IterT first, IterT last, std::error_code &ec,
+             size_t &error_offset, const Options &opt = Options{}) NOEXCEPT
 {
     ec.clear();
-    OutputT r{};
+    error_offset = 0;
+    // parsing errors are returned, only failures of the allocator or of the
+    // iterators are thrown
+    detail::parse_result<OutputT> r;
+#ifdef TYTI_VDF_EXCEPTIONS
     try
     {
-        r = read<OutputT>(first, last, opt);
+        r = detail::read_root<OutputT>(first, last, nullptr, opt);
     }
     catch (std::runtime_error &)
     {
         ec = std::make_error_code(std::errc::protocol_error);
+        return OutputT{};
     }
     catch (std::bad_alloc &)
     {
         ec = std::make_error_code(std::errc::not_enough_memory);
+        return OutputT{};
     }
     catch (...)
     {
         ec = std::make_error_code(std::errc::invalid_argument);
+        return OutputT{};
     }
-    return r;
+#else
+    r = detail::read_root<OutputT>(first, last, nullptr, opt);
+#endif
+    if (!r)
+    {
+        ec = std::make_error_code(std::errc::protocol_error);
+        error_offset = r.offset;
+        return OutputT{};
+    }
+    return std::move(r.value);
 }
 
 /** \brief Read VDF formatted sequences defined by the range [first, last).
@@ -764,6 +2177,25 @@ inline auto read(IterT first, IterT last, std::error_code &ec,
         first, last, ec, opt);
 }
 
+template <typename IterT>
+inline auto read(IterT first, IterT last, std::error_code &ec,
+                 size_t &error_offset, const Options &opt = Options{}) NOEXCEPT
+    -> basic_object<typename std::iterator_traits<IterT>::value_type>
+{
+    return read<basic_object<typename std::iterator_traits<IterT>::value_type>>(
+        first, last, ec, error_offset, opt);
+}
+
+template <typename IterT>
+inline auto read(IterT first, const IterT last,
+                 std::vector<diagnostic> &diagnostics,
+                 const Options &opt = Options{})
+    -> basic_object<typename std::iterator_traits<IterT>::value_type>
+{
+    return read<basic_object<typename std::iterator_traits<IterT>::value_type>>(
+        first, last, diagnostics, opt);
+}
+
 template <typename IterT>
 inline auto read(IterT first, const IterT last, const Options &opt = Options{})
     -> basic_object<typename std::iterator_traits<IterT>::value_type>
@@ -781,7 +2213,7 @@ OutputT read(iStreamT &inStream, std::error_code &ec,
 {
     // cache the file
     typedef typename iStreamT::char_type charT;
-    std::basic_string<charT> str = detail::read_file(inStream);
+    std::basic_string<charT> str = detail::read_text(inStream, opt);
 
     // parse it
     return read<OutputT>(str.begin(), str.end(), ec, opt);
@@ -825,7 +2257,7 @@ OutputT read(iStreamT &inStream, const Options &opt)
 
     // cache the file
     typedef typename iStreamT::char_type charT;
-    std::basic_string<charT> str = detail::read_file(inStream);
+    std::basic_string<charT> str = detail::read_text(inStream, opt);
     // parse it
     return read<OutputT>(str.begin(), str.end(), opt);
 }
@@ -837,6 +2269,46 @@ read(iStreamT &inStream, const Options &opt = Options{})
     return read<basic_object<typename iStreamT::char_type>>(inStream, opt);
 }
 
+/** \brief reads UTF-16 encoded vdf data, e.g. Valve's localization files, into
+a narrow object with UTF-8 strings. [first, last) are the raw bytes of the
+text. A byte order mark selects little or big endian, without one, little
+endian is assumed. The text is transcoded before it is parsed, so the offsets
+of parsing errors refer to the UTF-8 text.
+can throw:
+    - "parse_error" if a parsing error occured
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+template <typename OutputT>
+OutputT read_utf16(const char *first, const char *last,
+                   const Options &opt = Options{})
+{
+    const std::string text = detail::utf16_bytes_to_utf8(first, last);
+    return read<OutputT>(text.begin(), text.end(), opt);
+}
+
+inline object read_utf16(const char *first, const char *last,
+                         const Options &opt = Options{})
+{
+    return read_utf16<object>(first, last, opt);
+}
+
+/** \brief same as read_utf16() for the bytes of a stream, which should be
+opened in binary mode
+*/
+template <typename OutputT>
+OutputT read_utf16(std::istream &inStream, const Options &opt = Options{})
+{
+    const std::string bytes = detail::read_file(inStream);
+    return read_utf16<OutputT>(bytes.data(), bytes.data() + bytes.size(),
+                               opt);
+}
+
+inline object read_utf16(std::istream &inStream,
+                         const Options &opt = Options{})
+{
+    return read_utf16<object>(inStream, opt);
+}
+
 } // namespace vdf
 } // namespace tyti
 #ifndef TYTI_NO_L_UNDEF
@@ -0,0 +1,434 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_PATCH_H__
+#define __TYTI_STEAM_VDF_PATCH_H__
+
+#include "vdf_mapped_file.hpp"
+#include "vdf_parser.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/// byte range of a value inside a vdf text, relative to its begin.
+/// For quoted values, the range excludes the quotes
+struct value_location
+{
+    size_t begin = 0;
+    size_t end = 0;
+    bool quoted = false;
+};
+
+namespace detail
+{
+/// prevents template argument deduction from a parameter
+template <typename T> struct non_deduced
+{
+    typedef T type;
+};
+
+template <typename charT> struct scan_token
+{
+    enum kind_t
+    {
+        string,
+        open,
+        close,
+        conditional,
+        eof
+    };
+    kind_t kind;
+    const charT *begin;
+    const charT *end;
+    bool quoted;
+};
+
+/// splits vdf text into tokens, skipping whitespaces and comments,
+/// following the rules of read()
+template <typename charT> class token_scanner
+{
+  public:
+    token_scanner(const charT *first, const charT *last, const Options &opt)
+        : cur_(first), last_(last), strip_(opt.strip_escape_symbols)
+    {
+    }
+
+    /// position of the next character, which was not consumed yet
+    const charT *position() const noexcept { return cur_; }
+
+    /// continues scanning at pos
+    void seek(const charT *pos) noexcept { cur_ = pos; }
+
+    /// true, if a comment or an unquoted word ended at the end of the range
+    /// instead of at its terminator. Then the range may not be scanned on
+    /// its own, as the token could continue behind it
+    bool truncated() const noexcept { return truncated_; }
+
+    /// the token which the caller expects next. Like read(), braces and
+    /// brackets which cannot start it are the begin of an unquoted word:
+    /// '{' and '[' in front of a key, '}' in front of a value
+    enum expect_t
+    {
+        any,
+        key,
+        value
+    };
+
+    /// throws "std::runtime_error" for unclosed quotes and conditionals
+    scan_token<charT> next(expect_t expect = any)
+    {
+        typedef scan_token<charT> token;
+        for (;;)
+        {
+            while (cur_ != last_ && is_whitespace(*cur_))
+                ++cur_;
+            if (cur_ == last_ || *cur_ == '\0')
+                return token{token::eof, cur_, cur_, false};
+
+            const charT c = *cur_;
+            if (c == '/')
+            {
+                skip_comment();
+                continue;
+            }
+            if (c == '[' && expect != key)
+            {
+                const charT *begin = ++cur_;
+                cur_ = std::find(cur_, last_, charT(']'));
+                if (cur_ == last_)
+                    throw std::runtime_error("conditional not closed");
+                return token{token::conditional, begin, cur_++, false};
+            }
+            if ((c == '{' && expect != key) || (c == '}' && expect != value))
+            {
+                ++cur_;
+                return token{c == '{' ? token::open : token::close, cur_ - 1,
+                             cur_, false};
+            }
+            if (c == '"')
+            {
+                const charT *begin = ++cur_;
+                const charT *end = end_quote(begin);
+                cur_ = end + 1;
+                return token{token::string, begin, end, true};
+            }
+            const charT *begin = cur_;
+            cur_ = end_word(begin);
+            if (cur_ == last_)
+                truncated_ = true;
+            return token{token::string, begin, cur_, false};
+        }
+    }
+
+    /// text of the token, with escape symbols stripped like read() does
+    std::basic_string<charT> str(const scan_token<charT> &t) const
+    {
+        std::basic_string<charT> s(t.begin, t.end);
+        if (!strip_ || s.find(charT('\\')) == s.npos)
+            return s;
+        const charT quote[] = {'\\', '"', 0};
+        const charT backslash[] = {'\\', '\\', 0};
+        for (size_t p = s.find(quote); p != s.npos; p = s.find(quote, p + 1))
+            s.replace(p, 2, 1, charT('"'));
+        for (size_t p = s.find(backslash); p != s.npos;
+             p = s.find(backslash, p + 1))
+            s.replace(p, 2, 1, charT('\\'));
+        return s;
+    }
+
+    /// compares the token with str, after stripping escape symbols
+    bool equals(const scan_token<charT> &t,
+                const std::basic_string<charT> &str) const
+    {
+        const size_t size = static_cast<size_t>(t.end - t.begin);
+        if (!strip_ || std::find(t.begin, t.end, charT('\\')) == t.end)
+            return size == str.size() &&
+                   std::equal(t.begin, t.end, str.begin());
+        return this->str(t) == str;
+    }
+
+  private:
+    static bool is_whitespace(charT c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+               c == '\f';
+    }
+
+    /// number of backslashes directly in front of pos, down to begin
+    static size_t escapes_before(const charT *begin, const charT *pos) noexcept
+    {
+        size_t n = 0;
+        while (pos != begin && *(pos - 1) == '\\')
+        {
+            --pos;
+            ++n;
+        }
+        return n;
+    }
+
+    void skip_comment()
+    {
+        ++cur_;
+        if (cur_ == last_)
+        {
+            truncated_ = true;
+            return;
+        }
+        if (*cur_ == '/')
+        {
+            cur_ = std::find(cur_, last_, charT('\n'));
+            if (cur_ == last_)
+                truncated_ = true;
+        }
+        else if (*cur_ == '*')
+        {
+            const charT comment_end[] = {'*', '/'};
+            cur_ = std::search(cur_ + 1, last_, comment_end, comment_end + 2);
+            if (cur_ == last_)
+                truncated_ = true;
+            else
+                cur_ += 2;
+        }
+    }
+
+    const charT *end_quote(const charT *begin) const
+    {
+        const charT *iter = begin;
+        for (;;)
+        {
+            iter = std::find(iter, last_, charT('"'));
+            if (iter == last_)
+                throw std::runtime_error{"quote was opened but not closed."};
+            if (!strip_ || escapes_before(begin, iter) % 2 == 0)
+                return iter;
+            ++iter;
+        }
+    }
+
+    const charT *end_word(const charT *begin) const
+    {
+        const charT *iter = begin;
+        for (;;)
+        {
+            while (iter != last_ && !is_whitespace(*iter))
+                ++iter;
+            // like in read(), the first character does not escape
+            if (iter == last_ || escapes_before(begin + 1, iter) % 2 == 0)
+                return iter;
+            ++iter;
+        }
+    }
+
+    const charT *cur_;
+    const charT *last_;
+    const bool strip_;
+    bool truncated_ = false;
+};
+
+/// text which replaces the value at loc
+template <typename charT>
+std::basic_string<charT>
+patch_replacement(const value_location &loc,
+                  const std::basic_string<charT> &value,
+                  const WriteOptions &opts)
+{
+    std::basic_string<charT> out;
+    if (!loc.quoted && is_unquoted_token(value))
+        return value;
+    if (!loc.quoted)
+        out += charT('"');
+    append_string(out, value, opts);
+    if (!loc.quoted)
+        out += charT('"');
+    return out;
+}
+} // namespace detail
+
+/** \brief finds the value at the given key path, e.g. {"AppState", "buildid"}.
+Only the text up to the value is scanned, nothing is parsed into objects.
+@return true if the value was found, its position is stored in loc
+can throw:
+    - "std::runtime_error" if the text is malformed before the value
+*/
+template <typename charT>
+bool find_value(
+    const charT *first, const charT *last,
+    const typename detail::non_deduced<
+        std::vector<std::basic_string<charT>>>::type &path,
+    value_location &loc, const Options &opt = Options{})
+{
+    typedef detail::scan_token<charT> token;
+    typedef detail::token_scanner<charT> scanner_t;
+    if (path.empty())
+        return false;
+
+    scanner_t scanner(first, last, opt);
+    // number of enclosing objects and how many of them match the path
+    size_t depth = 0;
+    size_t matched = 0;
+    bool has_key = false;
+    bool key_matches = false;
+    for (;;)
+    {
+        const token t = scanner.next(has_key ? scanner_t::value
+                                             : scanner_t::key);
+        switch (t.kind)
+        {
+        case token::eof:
+            return false;
+        case token::conditional:
+            // an unfulfilled conditional behind a key drops it, like in read()
+            if (has_key && !detail::conditional_fulfilled(
+                               std::basic_string<charT>(t.begin, t.end), opt))
+                has_key = false;
+            break;
+        case token::open:
+            if (has_key && key_matches && depth + 1 < path.size())
+                ++matched;
+            ++depth;
+            has_key = false;
+            break;
+        case token::close:
+            if (depth > 0)
+                --depth;
+            matched = std::min(matched, depth);
+            has_key = false;
+            break;
+        case token::string:
+            if (!has_key)
+            {
+                has_key = true;
+                key_matches = depth == matched && depth < path.size() &&
+                              scanner.equals(t, path[depth]);
+            }
+            else
+            {
+                has_key = false;
+                if (!key_matches || depth + 1 != path.size())
+                    break;
+                // a conditional behind the value decides, whether it is
+                // used, like in read()
+                const charT *pos = scanner.position();
+                const token cond = scanner.next();
+                if (cond.kind != token::conditional)
+                    scanner.seek(pos);
+                else if (!detail::conditional_fulfilled(
+                             std::basic_string<charT>(cond.begin, cond.end),
+                             opt))
+                    break;
+                loc.begin = static_cast<size_t>(t.begin - first);
+                loc.end = static_cast<size_t>(t.end - first);
+                loc.quoted = t.quoted;
+                return true;
+            }
+            break;
+        }
+    }
+}
+
+/** \brief replaces the first value at the given key path in data, e.g.
+{"AppState", "buildid"}. Everything else, including comments and the order of
+the keys, stays untouched.
+@return false, if there is no such value
+can throw:
+    - "std::runtime_error" if the text is malformed before the value
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+template <typename charT>
+bool patch_value(
+    std::basic_string<charT> &data,
+    const typename detail::non_deduced<
+        std::vector<std::basic_string<charT>>>::type &path,
+    const typename detail::non_deduced<std::basic_string<charT>>::type &value,
+    const Options &opt = Options{}, const WriteOptions &wopt = WriteOptions{})
+{
+    value_location loc;
+    if (!find_value(data.data(), data.data() + data.size(), path, loc, opt))
+        return false;
+    data.replace(loc.begin, loc.end - loc.begin,
+                 detail::patch_replacement(loc, value, wopt));
+    return true;
+}
+
+/** \brief replaces the first value at the given key path in the given file.
+The file is scanned up to the value. If the new value has the same length, it
+is overwritten in place, otherwise only the rest of the file behind the value
+is rewritten.
+@return false, if there is no such value
+can throw:
+    - "std::system_error" if the file cannot be read or written
+    - "std::runtime_error" if the text is malformed before the value
+    - "std::bad_alloc" if not enough memory could be allocated
+*/
+inline bool patch_file(const std::string &filename,
+                       const std::vector<std::string> &path,
+                       const std::string &value,
+                       const Options &opt = Options{},
+                       const WriteOptions &wopt = WriteOptions{})
+{
+    std::string replacement;
+    std::string tail;
+    value_location loc;
+    size_t old_size = 0;
+    {
+        const detail::mapped_file file(filename);
+        if (!find_value(file.begin(), file.end(), path, loc, opt))
+            return false;
+        replacement = detail::patch_replacement(loc, value, wopt);
+        if (replacement.size() != loc.end - loc.begin)
+            tail.assign(file.begin() + loc.end, file.end());
+        old_size = file.size();
+    }
+
+    {
+        std::fstream out(filename,
+                         std::ios::in | std::ios::out | std::ios::binary);
+        out.seekp(static_cast<std::streamoff>(loc.begin));
+        out.write(replacement.data(),
+                  static_cast<std::streamsize>(replacement.size()));
+        out.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+        out.flush();
+        if (!out)
+            throw std::system_error(std::make_error_code(std::errc::io_error),
+                                    "cannot write " + filename);
+    }
+    const size_t new_size = loc.begin + replacement.size() +
+                            (tail.empty() ? old_size - loc.end : tail.size());
+    if (new_size < old_size)
+        detail::resize_file(filename, new_size);
+    return true;
+}
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_PATCH_H__
@@ -0,0 +1,523 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_SNAPSHOT_H__
+#define __TYTI_STEAM_VDF_SNAPSHOT_H__
+
+#include "vdf_binary.hpp"
+#include "vdf_mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tyti
+{
+namespace vdf
+{
+
+/*
+Layout of a snapshot. All numbers are little endian, all positions are offsets
+from the beginning of the snapshot, so it can be mapped at any address.
+
+header:     magic (8 bytes), version (u32), reserved (u32), root node (u64),
+            string table offset (u64), string table size (u64), total size (u64)
+string:     offset into the string table (u64), size (u64). Every string in the
+            table is null terminated.
+node:       name (string), attribute count (u64), attribute table (u64),
+            child count (u64), child table (u64)
+attribute:  key (string), value (string). Sorted by key.
+child:      key (string), node (u64). Sorted by key.
+*/
+namespace detail
+{
+const char snapshot_magic[8] = {'V', 'D', 'F', 'S', 'N', 'A', 'P', '\0'};
+enum : std::uint32_t
+{
+    snapshot_version = 1,
+    snapshot_header_size = 48,
+    snapshot_string_size = 16,
+    snapshot_node_size = 48,
+    snapshot_attrib_size = 32,
+    snapshot_child_size = 24
+};
+
+/// compares like std::string::compare
+inline int compare_bytes(const char *a, std::size_t a_size, const char *b,
+                         std::size_t b_size) noexcept
+{
+    const int r = std::memcmp(a, b, std::min(a_size, b_size));
+    if (r != 0)
+        return r;
+    return a_size < b_size ? -1 : (a_size > b_size ? 1 : 0);
+}
+
+/// serializes an object tree into the snapshot layout
+class snapshot_writer
+{
+  public:
+    template <typename T> std::string write(const T &root)
+    {
+        std::string out(snapshot_header_size, '\0');
+        const std::uint64_t root_pos = reserve(out, snapshot_node_size);
+
+        // breadth first. Every node record is reserved by its parent, so the
+        // child tables can refer to them before they are written.
+        std::deque<std::pair<const T *, std::uint64_t>> todo;
+        todo.emplace_back(&root, root_pos);
+        std::vector<const std::pair<const std::string, std::string> *> attribs;
+        std::vector<const T *> childs;
+        while (!todo.empty())
+        {
+            const T &node = *todo.front().first;
+            const std::uint64_t pos = todo.front().second;
+            todo.pop_front();
+
+            attribs.clear();
+            for (const auto &a : node.attribs)
+                attribs.push_back(&a);
+            std::stable_sort(attribs.begin(), attribs.end(),
+                             [](const std::pair<const std::string, std::string>
+                                    *a,
+                                const std::pair<const std::string, std::string>
+                                    *b) { return a->first < b->first; });
+            childs.clear();
+            for (const auto &c : node.childs)
+                if (c.second)
+                    childs.push_back(c.second.get());
+            std::stable_sort(childs.begin(), childs.end(),
+                             [](const T *a, const T *b)
+                             { return a->name < b->name; });
+
+            const std::uint64_t attrib_table =
+                reserve(out, attribs.size() * snapshot_attrib_size);
+            std::uint64_t entry = attrib_table;
+            for (const auto *a : attribs)
+            {
+                entry = put_string(out, entry, a->first);
+                entry = put_string(out, entry, a->second);
+            }
+
+            const std::uint64_t child_table =
+                reserve(out, childs.size() * snapshot_child_size);
+            const std::uint64_t child_nodes =
+                reserve(out, childs.size() * snapshot_node_size);
+            entry = child_table;
+            for (std::size_t i = 0; i < childs.size(); ++i)
+            {
+                const std::uint64_t child_pos =
+                    child_nodes + i * snapshot_node_size;
+                entry = put_string(out, entry, childs[i]->name);
+                entry = put(out, entry, child_pos);
+                todo.emplace_back(childs[i], child_pos);
+            }
+
+            std::uint64_t record = put_string(out, pos, node.name);
+            record = put(out, record, attribs.size());
+            record = put(out, record, attrib_table);
+            record = put(out, record, childs.size());
+            put(out, record, child_table);
+        }
+
+        const std::uint64_t string_table = out.size();
+        out += strings_;
+        out.replace(0, 8, snapshot_magic, 8);
+        std::uint64_t header = put32(out, 8, snapshot_version);
+        header = put32(out, header, 0);
+        header = put(out, header, root_pos);
+        header = put(out, header, string_table);
+        header = put(out, header, strings_.size());
+        put(out, header, out.size());
+        return out;
+    }
+
+  private:
+    static std::uint64_t reserve(std::string &out, std::size_t n)
+    {
+        const std::uint64_t pos = out.size();
+        out.append(n, '\0');
+        return pos;
+    }
+
+    // overwrites the reserved bytes at pos with the little endian value
+    template <typename UIntT>
+    static std::uint64_t put(std::string &out, std::uint64_t pos, UIntT v)
+    {
+        for (std::size_t i = 0; i < sizeof(std::uint64_t); ++i)
+            out[static_cast<std::size_t>(pos) + i] = static_cast<char>(
+                (static_cast<std::uint64_t>(v) >> (8 * i)) & 0xFF);
+        return pos + sizeof(std::uint64_t);
+    }
+
+    static std::uint64_t put32(std::string &out, std::uint64_t pos,
+                               std::uint32_t v)
+    {
+        for (std::size_t i = 0; i < sizeof(std::uint32_t); ++i)
+            out[static_cast<std::size_t>(pos) + i] =
+                static_cast<char>((v >> (8 * i)) & 0xFF);
+        return pos + sizeof(std::uint32_t);
+    }
+
+    std::uint64_t put_string(std::string &out, std::uint64_t pos,
+                             const std::string &s)
+    {
+        auto it = interned_.find(s);
+        if (it == interned_.end())
+        {
+            it = interned_.emplace(s, strings_.size()).first;
+            strings_ += s;
+            strings_ += '\0';
+        }
+        pos = put(out, pos, it->second);
+        return put(out, pos, s.size());
+    }
+
+    std::string strings_;
+    std::unordered_map<std::string, std::uint64_t> interned_;
+};
+} // namespace detail
+
+/// non-owning reference to a string inside a snapshot. Evaluates to false, if
+/// a lookup did not find anything.
+struct snapshot_string
+{
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+    explicit operator bool() const noexcept { return data != nullptr; }
+    /// strings of a snapshot are always null terminated
+    const char *c_str() const noexcept { return data; }
+    std::string str() const { return data ? std::string(data, size) : ""; }
+
+    bool operator==(const std::string &o) const noexcept
+    {
+        return data && size == o.size() &&
+               std::memcmp(data, o.data(), size) == 0;
+    }
+    bool operator!=(const std::string &o) const noexcept
+    {
+        return !(*this == o);
+    }
+};
+
+/// view of a single object inside a snapshot. Evaluates to false, if a lookup
+/// did not find anything.
+class snapshot_node
+{
+  public:
+    snapshot_node() = default;
+
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+
+    snapshot_string name() const { return string_at(pos_); }
+
+    std::size_t attribute_count() const { return count(pos_ + 16); }
+    snapshot_string attribute_key(std::size_t i) const
+    {
+        return string_at(attribute_entry(i));
+    }
+    snapshot_string attribute_value(std::size_t i) const
+    {
+        return string_at(attribute_entry(i) + detail::snapshot_string_size);
+    }
+
+    /// value of the (first) attribute with the given key
+    snapshot_string attribute(const std::string &key) const
+    {
+        const auto range = attribute_range(key);
+        if (range.first == range.second)
+            return snapshot_string{};
+        return attribute_value(range.first);
+    }
+
+    /// index range [first, second) of all attributes with the given key
+    std::pair<std::size_t, std::size_t>
+    attribute_range(const std::string &key) const
+    {
+        return equal_range(attribute_count(), key,
+                           [this](std::size_t i)
+                           { return attribute_key(i); });
+    }
+
+    std::size_t child_count() const { return count(pos_ + 32); }
+    snapshot_node child(std::size_t i) const
+    {
+        return snapshot_node(data_, size_,
+                             load(child_entry(i) + detail::snapshot_string_size));
+    }
+
+    /// (first) child with the given name
+    snapshot_node child(const std::string &key) const
+    {
+        const auto range = child_range(key);
+        if (range.first == range.second)
+            return snapshot_node{};
+        return child(range.first);
+    }
+
+    /// index range [first, second) of all childs with the given name
+    std::pair<std::size_t, std::size_t>
+    child_range(const std::string &key) const
+    {
+        return equal_range(child_count(), key, [this](std::size_t i)
+                           { return string_at(child_entry(i)); });
+    }
+
+    /** \brief creates a regular object tree of the snapshot.
+    throws "std::runtime_error" if the snapshot is corrupted, e.g. if a child
+    refers back to one of its parents
+    */
+    template <typename OutputT = object> OutputT to_object() const
+    {
+        struct level
+        {
+            snapshot_node node;
+            std::unique_ptr<OutputT> obj;
+            std::size_t next_child;
+        };
+        auto open = [](const snapshot_node &n)
+        {
+            std::unique_ptr<OutputT> obj = std::make_unique<OutputT>();
+            obj->set_name(n.name().str());
+            const std::size_t attribs = n.attribute_count();
+            for (std::size_t i = 0; i < attribs; ++i)
+                obj->add_attribute(n.attribute_key(i).str(),
+                                   n.attribute_value(i).str());
+            return level{n, std::move(obj), 0};
+        };
+
+        // the writer places every node behind its parent, so a cycle or a
+        // node shared by several parents is a corrupted snapshot
+        const std::size_t max_nodes = size_ / detail::snapshot_node_size;
+        std::size_t nodes = 1;
+        std::vector<level> lvls;
+        lvls.push_back(open(*this));
+        while (true)
+        {
+            level &top = lvls.back();
+            if (top.next_child < top.node.child_count())
+            {
+                const snapshot_node c = top.node.child(top.next_child++);
+                if (c.pos_ <= top.node.pos_ || ++nodes > max_nodes)
+                    throw std::runtime_error{"snapshot is corrupted"};
+                lvls.push_back(open(c));
+                continue;
+            }
+            std::unique_ptr<OutputT> done = std::move(top.obj);
+            lvls.pop_back();
+            if (lvls.empty())
+                return std::move(*done);
+            lvls.back().obj->add_child(std::move(done));
+        }
+    }
+
+  private:
+    friend class snapshot;
+
+    snapshot_node(const char *data, std::size_t size, std::uint64_t pos)
+        : data_(data), size_(size), pos_(pos)
+    {
+        check(pos_, detail::snapshot_node_size);
+    }
+
+    void check(std::uint64_t pos, std::uint64_t n) const
+    {
+        if (pos > size_ || n > size_ - pos)
+            throw std::runtime_error{"snapshot is corrupted"};
+    }
+
+    std::uint64_t load(std::uint64_t pos) const
+    {
+        check(pos, 8);
+        return detail::load_le64(data_ + pos);
+    }
+
+    std::size_t count(std::uint64_t pos) const
+    {
+        return static_cast<std::size_t>(load(pos));
+    }
+
+    std::uint64_t attribute_entry(std::size_t i) const
+    {
+        if (i >= attribute_count())
+            throw std::out_of_range{"attribute index out of range"};
+        return load(pos_ + 24) + i * detail::snapshot_attrib_size;
+    }
+
+    std::uint64_t child_entry(std::size_t i) const
+    {
+        if (i >= child_count())
+            throw std::out_of_range{"child index out of range"};
+        return load(pos_ + 40) + i * detail::snapshot_child_size;
+    }
+
+    snapshot_string string_at(std::uint64_t pos) const
+    {
+        const std::uint64_t table = detail::load_le64(data_ + 24);
+        const std::uint64_t offset = load(pos);
+        const std::uint64_t size = load(pos + 8);
+        // including the null terminator, which c_str() relies on
+        if (offset > size_ - table || size >= size_ - table - offset ||
+            data_[table + offset + size] != '\0')
+            throw std::runtime_error{"snapshot is corrupted"};
+        snapshot_string s;
+        s.data = data_ + table + offset;
+        s.size = static_cast<std::size_t>(size);
+        return s;
+    }
+
+    template <typename KeyF>
+    std::pair<std::size_t, std::size_t>
+    equal_range(std::size_t n, const std::string &key, KeyF key_at) const
+    {
+        auto less = [&key, &key_at](std::size_t i, bool upper)
+        {
+            const snapshot_string k = key_at(i);
+            const int c =
+                detail::compare_bytes(k.data, k.size, key.data(), key.size());
+            return upper ? c <= 0 : c < 0;
+        };
+        std::size_t lo = 0, hi = n;
+        while (lo < hi)
+        {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            if (less(mid, false))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        std::size_t first = lo;
+        hi = n;
+        while (lo < hi)
+        {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            if (less(mid, true))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return std::make_pair(first, lo);
+    }
+
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint64_t pos_ = 0;
+};
+
+/** \brief A parsed object tree in a position independent binary layout.
+The snapshot is queried in place, e.g. directly from a memory mapped file,
+without deserializing it. Keys of attributes and childs are sorted, lookups
+are binary searches.
+*/
+class snapshot
+{
+  public:
+    snapshot() = default;
+
+    /// uses the memory mapped snapshot.
+    /// throws "std::runtime_error" if it is not a valid snapshot
+    explicit snapshot(detail::mapped_file file)
+        : file_(std::make_shared<detail::mapped_file>(std::move(file)))
+    {
+        init(file_->data(), file_->size());
+    }
+
+    /// uses the snapshot stored in the given buffer.
+    /// throws "std::runtime_error" if it is not a valid snapshot
+    explicit snapshot(std::string data)
+        : buffer_(std::make_shared<std::string>(std::move(data)))
+    {
+        init(buffer_->data(), buffer_->size());
+    }
+
+    snapshot_node root() const
+    {
+        if (!data_)
+            return snapshot_node{};
+        return snapshot_node(data_, size_, detail::load_le64(data_ + 16));
+    }
+
+    const char *data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+
+  private:
+    void init(const char *data, std::size_t size)
+    {
+        if (size < detail::snapshot_header_size ||
+            !std::equal(data, data + 8, detail::snapshot_magic) ||
+            detail::load_le32(data + 8) != detail::snapshot_version ||
+            detail::load_le64(data + 40) != size)
+            throw std::runtime_error{"not a valid vdf snapshot"};
+        const std::uint64_t table = detail::load_le64(data + 24);
+        const std::uint64_t table_size = detail::load_le64(data + 32);
+        if (table > size || table_size != size - table)
+            throw std::runtime_error{"not a valid vdf snapshot"};
+        data_ = data;
+        size_ = size;
+    }
+
+    std::shared_ptr<detail::mapped_file> file_;
+    std::shared_ptr<std::string> buffer_;
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/// appends the snapshot of the given object tree to the buffer
+template <typename T> void write_snapshot(std::string &out, const T &obj)
+{
+    out += detail::snapshot_writer().write(obj);
+}
+
+/** \brief stores the snapshot of the given object tree in a file.
+throws "std::runtime_error" if the file cannot be written
+*/
+template <typename T> void save_snapshot(const T &obj, const std::string &path)
+{
+    const std::string data = detail::snapshot_writer().write(obj);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out)
+        throw std::runtime_error{"cannot write snapshot " + path};
+}
+
+/** \brief maps the snapshot file into memory.
+can throw:
+    - "std::system_error" if the file cannot be opened or mapped
+    - "std::runtime_error" if the file is not a valid snapshot
+*/
+inline snapshot open_snapshot(const std::string &path)
+{
+    return snapshot(detail::mapped_file(path));
+}
+
+} // namespace vdf
+} // namespace tyti
+
+#endif //__TYTI_STEAM_VDF_SNAPSHOT_H__
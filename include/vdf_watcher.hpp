@@ -0,0 +1,520 @@
+// MIT License
+//
+// Copyright(c) 2016 Matthias Moeller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TYTI_STEAM_VDF_WATCHER_H__
+#define __TYTI_STEAM_VDF_WATCHER_H__
+
+// the watcher is based on inotify and only available on Linux
+#ifdef __linux__
+
+#include "vdf_mapped_file.hpp"
+#include "vdf_parser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace tyti
+{
+namespace vdf
+{
+
+struct WatchOptions
+{
+    /// time without further writes to a file, before it is parsed again
+    std::chrono::milliseconds debounce{100};
+    /// extensions of the files, which are watched in watched directories
+    std::vector<std::string> extensions = {".vdf", ".acf"};
+};
+
+namespace detail
+{
+/// splits a path into its canonical directory and the file name
+inline std::pair<std::string, std::string>
+split_watched_path(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    const std::string dir =
+        slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    return {canonical_path(dir), path.substr(slash + 1)};
+}
+
+inline bool ends_with_any(const std::string &name,
+                          const std::vector<std::string> &suffixes)
+{
+    for (const auto &s : suffixes)
+        if (name.size() >= s.size() &&
+            name.compare(name.size() - s.size(), s.size(), s) == 0)
+            return true;
+    return false;
+}
+} // namespace detail
+
+/** \brief Watches vdf files and directories via inotify and parses changed
+files again.
+Writes to a file are debounced: a file is only parsed, after it was not
+written for WatchOptions::debounce. Every new tree is published through the
+callback and can be queried by get(). Files are parsed on a background thread,
+which also calls the callback. The callback must not throw.
+
+Only Linux is supported. Directories are watched instead of the files itself,
+so files replaced via rename are picked up as well.
+*/
+template <typename OutputT = object> class basic_file_watcher
+{
+  public:
+    /** called with the path of the changed file and its new tree.
+    If the file could not be parsed, tree is nullptr and ec holds the error,
+    get() keeps returning the last valid tree.
+    If the file was removed, tree is nullptr and ec is
+    std::errc::no_such_file_or_directory.
+    If watching failed, e.g. because inotify could not be read, path is empty
+    and ec holds the error. No further changes are reported, see error().
+    */
+    typedef std::function<void(const std::string &path,
+                               const std::shared_ptr<const OutputT> &tree,
+                               const std::error_code &ec)>
+        callback;
+
+    /** \brief starts the background thread.
+    can throw:
+        - "std::system_error" if inotify or the thread cannot be started
+    */
+    basic_file_watcher(callback cb, const Options &opt,
+                       const WatchOptions &wopt)
+        : cb_(std::move(cb)), opt_(opt), wopt_(wopt)
+    {
+        inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_ < 0)
+            throw std::system_error(errno, std::generic_category(),
+                                    "cannot initialize inotify");
+        wakeup_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_ < 0)
+        {
+            const int err = errno;
+            ::close(inotify_);
+            throw std::system_error(err, std::generic_category(),
+                                    "cannot create eventfd");
+        }
+        try
+        {
+            thread_ = std::thread([this] { run(); });
+        }
+        catch (...)
+        {
+            ::close(wakeup_);
+            ::close(inotify_);
+            throw;
+        }
+    }
+
+    explicit basic_file_watcher(callback cb, const Options &opt = Options{})
+        : basic_file_watcher(std::move(cb), opt, WatchOptions())
+    {
+    }
+
+    basic_file_watcher(const basic_file_watcher &) = delete;
+    basic_file_watcher &operator=(const basic_file_watcher &) = delete;
+
+    /// stops the background thread, no callback is called afterwards
+    ~basic_file_watcher()
+    {
+        stop_ = true;
+        wake();
+        thread_.join();
+        ::close(wakeup_);
+        ::close(inotify_);
+    }
+
+    /** \brief watches a file or all files in a directory, which have one of
+    WatchOptions::extensions. Subdirectories are not watched.
+    The watched files are parsed on the background thread and published
+    through the callback. A watched file does not need to exist yet, but its
+    directory does.
+    can throw:
+        - "std::system_error" if the path cannot be watched
+    */
+    void watch(const std::string &path)
+    {
+        bool is_dir = false;
+        {
+            DIR *d = ::opendir(path.c_str());
+            if (d)
+            {
+                is_dir = true;
+                ::closedir(d);
+            }
+        }
+        std::string dir;
+        std::string name;
+        if (is_dir)
+            dir = detail::canonical_path(path);
+        else
+            std::tie(dir, name) = detail::split_watched_path(path);
+        if (dir.empty() || dir.back() != '/')
+            dir += '/';
+
+        const int wd = ::inotify_add_watch(
+            inotify_, dir.c_str(),
+            IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+        if (wd < 0)
+            throw std::system_error(errno, std::generic_category(),
+                                    "cannot watch " + path);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            directory &d = dirs_[wd];
+            d.path = dir;
+            if (is_dir)
+                d.all = true;
+            else
+                d.names.insert(name);
+            // the initial parse happens on the background thread, like
+            // every other one
+            const auto now = clock::now();
+            if (is_dir)
+                for (const auto &n : list(dir))
+                    pending_[dir + n] = now;
+            else
+                pending_[dir + name] = now;
+        }
+        wake();
+    }
+
+    /** \brief the last valid tree of a watched file, nullptr if it was not
+    parsed yet, could never be parsed or was removed.
+    */
+    std::shared_ptr<const OutputT> get(const std::string &path) const
+    {
+        std::string key;
+        try
+        {
+            const auto p = detail::split_watched_path(path);
+            key = p.first + (p.first.back() == '/' ? "" : "/") + p.second;
+        }
+        catch (std::system_error &)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = trees_.find(key);
+        return it == trees_.end() ? nullptr : it->second;
+    }
+
+    /// the error which stopped the background thread, if watching failed.
+    /// Then changes are not reported anymore
+    std::error_code error() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return error_;
+    }
+
+  private:
+    typedef std::chrono::steady_clock clock;
+
+    /// a watched directory
+    struct directory
+    {
+        /// canonical path, ending with '/'
+        std::string path;
+        /// true, if all files with a watched extension are watched
+        bool all = false;
+        /// explicitly watched files
+        std::set<std::string> names;
+    };
+
+    bool watched(const directory &d, const std::string &name) const
+    {
+        return d.names.count(name) != 0 ||
+               (d.all && detail::ends_with_any(name, wopt_.extensions));
+    }
+
+    /// watched files in the directory
+    std::vector<std::string> list(const std::string &dir) const
+    {
+        std::vector<std::string> names;
+        DIR *d = ::opendir(dir.c_str());
+        if (!d)
+            return names;
+        while (const dirent *e = ::readdir(d))
+        {
+            const std::string name = e->d_name;
+            if ((e->d_type == DT_REG || e->d_type == DT_UNKNOWN ||
+                 e->d_type == DT_LNK) &&
+                detail::ends_with_any(name, wopt_.extensions))
+                names.push_back(name);
+        }
+        ::closedir(d);
+        return names;
+    }
+
+    void wake() noexcept
+    {
+        const std::uint64_t one = 1;
+        // a failed write means the counter is already set
+        const ssize_t written = ::write(wakeup_, &one, sizeof(one));
+        (void)written;
+    }
+
+    void run()
+    {
+        pollfd fds[2];
+        fds[0].fd = inotify_;
+        fds[0].events = POLLIN;
+        fds[1].fd = wakeup_;
+        fds[1].events = POLLIN;
+        while (!stop_)
+        {
+            int timeout = -1;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!pending_.empty())
+                {
+                    auto first = pending_.begin()->second;
+                    for (const auto &p : pending_)
+                        first = std::min(first, p.second);
+                    const auto wait =
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            first - clock::now())
+                            .count();
+                    timeout = static_cast<int>(std::max<decltype(wait)>(
+                        0, std::min<decltype(wait)>(wait + 1, 60000)));
+                }
+            }
+
+            if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+            {
+                fail(errno);
+                return;
+            }
+            if ((fds[0].revents | fds[1].revents) & (POLLERR | POLLNVAL))
+            {
+                fail(EBADF);
+                return;
+            }
+            if (fds[1].revents & POLLIN)
+            {
+                std::uint64_t count;
+                const ssize_t got = ::read(wakeup_, &count, sizeof(count));
+                (void)got;
+            }
+            if (stop_)
+                return;
+            if ((fds[0].revents & POLLIN) && !read_events())
+            {
+                fail(errno);
+                return;
+            }
+            reload_due();
+        }
+    }
+
+    /// publishes the error, which stops the background thread
+    void fail(int err)
+    {
+        const std::error_code ec(err, std::generic_category());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = ec;
+        }
+        cb_(std::string(), nullptr, ec);
+    }
+
+    /// drains the inotify queue and delays the changed files. Returns false
+    /// and leaves errno set, if the queue could not be read
+    bool read_events()
+    {
+        alignas(inotify_event) char buffer[16 * 1024];
+        const auto due = clock::now() + wopt_.debounce;
+        for (;;)
+        {
+            const ssize_t got = ::read(inotify_, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            if (got == 0)
+                return true;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (ssize_t pos = 0; pos < got;)
+            {
+                const auto *e =
+                    reinterpret_cast<const inotify_event *>(buffer + pos);
+                pos += static_cast<ssize_t>(sizeof(inotify_event) + e->len);
+
+                if (e->mask & IN_Q_OVERFLOW)
+                {
+                    // events were lost, check every file
+                    for (const auto &d : dirs_)
+                    {
+                        for (const auto &n : d.second.names)
+                            pending_[d.second.path + n] = due;
+                        if (d.second.all)
+                            for (const auto &n : list(d.second.path))
+                                pending_[d.second.path + n] = due;
+                    }
+                    continue;
+                }
+                if (e->mask & IN_IGNORED)
+                {
+                    dirs_.erase(e->wd);
+                    continue;
+                }
+                if (e->len == 0 || (e->mask & IN_ISDIR))
+                    continue;
+                const auto d = dirs_.find(e->wd);
+                const std::string name = e->name;
+                if (d != dirs_.end() && watched(d->second, name))
+                    pending_[d->second.path + name] = due;
+            }
+        }
+    }
+
+    /// parses all files, which were not written for the debounce time
+    void reload_due()
+    {
+        std::vector<std::string> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now = clock::now();
+            for (auto it = pending_.begin(); it != pending_.end();)
+            {
+                if (it->second <= now)
+                {
+                    due.push_back(it->first);
+                    it = pending_.erase(it);
+                }
+                else
+                    ++it;
+            }
+        }
+        for (const auto &path : due)
+        {
+            if (stop_)
+                return;
+            reload(path);
+        }
+    }
+
+    void reload(const std::string &path)
+    {
+        std::shared_ptr<const OutputT> tree;
+        std::error_code ec;
+        detail::file_identity id;
+        if (!detail::stat_file(path, id))
+        {
+            bool known = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                known = trees_.erase(path) != 0;
+            }
+            if (known)
+                cb_(path, nullptr,
+                    std::make_error_code(std::errc::no_such_file_or_directory));
+            return;
+        }
+
+        try
+        {
+            std::basic_ifstream<typename OutputT::char_type> file(
+                path, std::ios::binary);
+            if (!file)
+                throw std::system_error(errno, std::generic_category(),
+                                        "cannot open " + path);
+            // malformed files are common while they are written, they are
+            // reported without throwing
+            OutputT parsed = read<OutputT>(file, ec, opt_);
+            if (!ec)
+                tree = std::make_shared<const OutputT>(std::move(parsed));
+        }
+        catch (std::system_error &e)
+        {
+            ec = e.code();
+        }
+        catch (std::runtime_error &)
+        {
+            ec = std::make_error_code(std::errc::protocol_error);
+        }
+        catch (std::bad_alloc &)
+        {
+            ec = std::make_error_code(std::errc::not_enough_memory);
+        }
+
+        if (tree)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            trees_[path] = tree;
+        }
+        cb_(path, tree, ec);
+    }
+
+    callback cb_;
+    const Options opt_;
+    const WatchOptions wopt_;
+    int inotify_ = -1;
+    /// eventfd, which interrupts the poll of the background thread
+    int wakeup_ = -1;
+    std::atomic<bool> stop_{false};
+
+    mutable std::mutex mutex_;
+    /// watched directories by watch descriptor
+    std::unordered_map<int, directory> dirs_;
+    /// changed files and when they are parsed
+    std::map<std::string, clock::time_point> pending_;
+    std::unordered_map<std::string, std::shared_ptr<const OutputT>> trees_;
+    std::error_code error_;
+    std::thread thread_;
+};
+
+typedef basic_file_watcher<object> file_watcher;
+typedef basic_file_watcher<multikey_object> multikey_file_watcher;
+
+} // namespace vdf
+} // namespace tyti
+
+#endif // __linux__
+
+#endif //__TYTI_STEAM_VDF_WATCHER_H__
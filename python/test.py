@@ -14,6 +14,14 @@ class MyTest(unittest.TestCase):
         self.assertEqual(d["UserConfig"], {})
         self.assertEqual(len(d["MountedDepots"]), 1)
         self.assertEqual(d["another attribute with fancy space"], "yay")   
+
+    def test_read_threads(self):
+        # the files are parsed without the GIL
+        from concurrent.futures import ThreadPoolExecutor
+        with ThreadPoolExecutor(4) as pool:
+            files = pool.map(vdf.read_file, ["DST_Manifest.acf"] * 8)
+            for d in files:
+                self.assertEqual(d["AppState"]["appid"], "343050")
         
 
 if __name__ == "__main__":
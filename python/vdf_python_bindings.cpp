@@ -1,49 +1,100 @@
 #include "vdf_parser.hpp"
 #include <fstream>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl_bind.h>
 
 namespace py = pybind11;
 
-struct python_object
+// parsed without the GIL, so it must not hold any Python objects. The
+// entries keep the order of the file, which is the order of the dict
+struct native_object
 {
-    py::dict dict;
+    struct entry
+    {
+        std::string key;
+        std::string value;
+        std::unique_ptr<native_object> child; // null for attributes
+    };
+
     std::string name;
+    std::vector<entry> entries;
 
     void add_attribute(std::string key, std::string value)
     {
-        dict[py::cast(std::move(key))] = py::cast(std::move(value));
+        entries.push_back(entry{std::move(key), std::move(value), nullptr});
     }
-    void add_child(std::unique_ptr<python_object> child)
+    void add_child(std::unique_ptr<native_object> child)
     {
         std::string n = std::move(child->name);
-        dict[py::cast(n)] = std::move(child->dict);
+        entries.push_back(entry{std::move(n), std::string(), std::move(child)});
     }
     void set_name(std::string n) { name = std::move(n); }
 };
 
-py::dict py_read_file(const char *filename)
+// converts the whole tree at once, after parsing. Later keys replace
+// earlier ones, like assigning them to a dict one after another
+py::dict to_dict(const native_object &obj)
+{
+    py::dict root;
+    std::vector<std::pair<const native_object *, py::dict>> open;
+    open.emplace_back(&obj, root);
+    while (!open.empty())
+    {
+        const native_object &src = *open.back().first;
+        py::dict dst = std::move(open.back().second);
+        open.pop_back();
+        for (const auto &e : src.entries)
+        {
+            if (e.child)
+            {
+                py::dict child;
+                dst[py::cast(e.key)] = child;
+                open.emplace_back(e.child.get(), std::move(child));
+            }
+            else
+            {
+                dst[py::cast(e.key)] = py::cast(e.value);
+            }
+        }
+    }
+    return root;
+}
+
+py::dict to_python(const native_object &obj)
 {
-    std::ifstream input(filename);
-    auto obj = tyti::vdf::read<python_object>(input);
     if (obj.name.empty())
-        return obj.dict;
+        return to_dict(obj);
     auto result = py::dict();
-    result[py::cast(obj.name)] = std::move(obj.dict);
+    result[py::cast(obj.name)] = to_dict(obj);
     return result;
 }
 
+py::dict py_read_file(const char *filename)
+{
+    native_object obj;
+    {
+        // other Python threads run while the file is read and parsed
+        py::gil_scoped_release release;
+        std::ifstream input(filename);
+        obj = tyti::vdf::read<native_object>(input);
+    }
+    return to_python(obj);
+}
+
 py::dict py_read(const std::string &filename)
 {
-    auto obj = tyti::vdf::read<python_object>(std::begin(filename),
-                                              std::end(filename));
-    if (obj.name.empty())
-        return obj.dict;
-    auto result = py::dict();
-    result[py::cast(obj.name)] = std::move(obj.dict);
-    return result;
+    native_object obj;
+    {
+        py::gil_scoped_release release;
+        obj = tyti::vdf::read<native_object>(std::begin(filename),
+                                             std::end(filename));
+    }
+    return to_python(obj);
 }
 
 PYBIND11_MODULE(vdf, m)
@@ -52,4 +103,4 @@ PYBIND11_MODULE(vdf, m)
 
     m.def("read", &py_read, "Read vdf from memory");
     m.def("read_file", &py_read_file, "Read vdf file");
-}
\ No newline at end of file
+}
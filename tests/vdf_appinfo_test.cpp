@@ -0,0 +1,193 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <vdf_appinfo.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+void append_le32(std::string &out, std::uint32_t v)
+{
+    vdf::detail::store_le32(out, v);
+}
+
+std::string app_payload(std::uint32_t app_id)
+{
+    vdf::object common;
+    common.name = "common";
+    common.attribs["name"] = "App " + std::to_string(app_id);
+    vdf::object root;
+    root.name = "appinfo";
+    root.attribs["appid"] = std::to_string(app_id);
+    root.add_child(std::make_unique<vdf::object>(common));
+
+    std::string payload;
+    vdf::write_binary(payload, root);
+    return payload;
+}
+
+void append_record(std::string &out, std::uint32_t app_id,
+                   const std::string &payload)
+{
+    append_le32(out, app_id);
+    append_le32(out, static_cast<std::uint32_t>(60 + payload.size()));
+    append_le32(out, 2);                   // info state
+    append_le32(out, 1700000000);          // last updated
+    vdf::detail::store_le64(out, 0);       // pics token
+    out.append(20, 'a');                   // sha1
+    append_le32(out, 1000 + app_id);       // change number
+    out.append(20, 'b');                   // sha1 of the binary data
+    out += payload;
+}
+
+std::filesystem::path write_file(const std::string &name,
+                                 const std::string &data)
+{
+    const auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return path;
+}
+
+std::string appinfo_v28(std::initializer_list<std::uint32_t> app_ids)
+{
+    std::string data;
+    append_le32(data, vdf::detail::appinfo_magic_v28);
+    append_le32(data, 1);
+    for (auto id : app_ids)
+        append_record(data, id, app_payload(id));
+    append_le32(data, 0);
+    return data;
+}
+} // namespace
+
+TEST_CASE("appinfo random access")
+{
+    const auto path = write_file("vdf_test_appinfo.vdf",
+                                 appinfo_v28({440, 10, 730}));
+    vdf::appinfo_reader appinfo(path.string());
+
+    CHECK(appinfo.version() == 28);
+    CHECK(appinfo.universe() == 1);
+    REQUIRE(appinfo.size() == 3);
+    CHECK(appinfo.records().front().app_id == 10);
+    CHECK(appinfo.records().back().app_id == 730);
+
+    const auto *record = appinfo.find(440);
+    REQUIRE(record != nullptr);
+    CHECK(record->change_number == 1440);
+    CHECK(record->last_updated == 1700000000);
+
+    const auto app = appinfo.read(440);
+    CHECK(app.name == "appinfo");
+    CHECK(app.attribs.at("appid") == "440");
+    CHECK(app.childs.at("common")->attribs.at("name") == "App 440");
+
+    CHECK(!appinfo.contains(570));
+    CHECK_THROWS_AS(appinfo.read(570), std::out_of_range);
+    CHECK(appinfo.read<vdf::multikey_object>(730).attribs.count("appid") == 1);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("appinfo persisted index")
+{
+    const auto path =
+        write_file("vdf_test_appinfo_idx.vdf", appinfo_v28({1, 2, 3}));
+    const auto index =
+        std::filesystem::temp_directory_path() / "vdf_test_appinfo_idx.idx";
+    std::filesystem::remove(index);
+
+    {
+        vdf::appinfo_reader appinfo(path.string(), index.string());
+        CHECK(!appinfo.loaded_index());
+        CHECK(std::filesystem::exists(index));
+    }
+    {
+        vdf::appinfo_reader appinfo(path.string(), index.string());
+        CHECK(appinfo.loaded_index());
+        REQUIRE(appinfo.size() == 3);
+        CHECK(appinfo.read(2).attribs.at("appid") == "2");
+    }
+
+    // an index with trailing bytes is rebuilt
+    {
+        std::ofstream out(index, std::ios::binary | std::ios::app);
+        out << "x";
+    }
+    {
+        vdf::appinfo_reader appinfo(path.string(), index.string());
+        CHECK(!appinfo.loaded_index());
+        CHECK(appinfo.size() == 3);
+    }
+    {
+        vdf::appinfo_reader appinfo(path.string(), index.string());
+        CHECK(appinfo.loaded_index());
+    }
+
+    // a changed file invalidates the index
+    write_file("vdf_test_appinfo_idx.vdf", appinfo_v28({1, 2, 3, 4}));
+    {
+        vdf::appinfo_reader appinfo(path.string(), index.string());
+        CHECK(!appinfo.loaded_index());
+        CHECK(appinfo.size() == 4);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(index);
+}
+
+TEST_CASE("appinfo v29 string table")
+{
+    // payload with keys as indices into the string table
+    std::string payload;
+    payload += static_cast<char>(vdf::binary_type::object);
+    append_le32(payload, 0);
+    payload += static_cast<char>(vdf::binary_type::int32);
+    append_le32(payload, 1);
+    append_le32(payload, 570);
+    payload += static_cast<char>(vdf::binary_type::end);
+    payload += static_cast<char>(vdf::binary_type::end);
+
+    std::string data;
+    append_le32(data, vdf::detail::appinfo_magic_v29);
+    append_le32(data, 1);
+    vdf::detail::store_le64(data, 0); // patched below
+    append_record(data, 570, payload);
+    append_le32(data, 0);
+    const auto table = data.size();
+    append_le32(data, 2);
+    data += std::string("appinfo\0appid\0", 14);
+    std::string offset;
+    vdf::detail::store_le64(offset, table);
+    data.replace(8, 8, offset);
+
+    const auto path = write_file("vdf_test_appinfo_v29.vdf", data);
+    {
+        vdf::appinfo_reader appinfo(path.string());
+        CHECK(appinfo.version() == 29);
+        const auto app = appinfo.read(570);
+        CHECK(app.name == "appinfo");
+        CHECK(app.attribs.at("appid") == "570");
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("appinfo errors")
+{
+    CHECK_THROWS_AS(vdf::appinfo_reader("does_not_exist.vdf"),
+                    std::system_error);
+
+    const auto path = write_file("vdf_test_appinfo_bad.vdf", "not appinfo");
+    CHECK_THROWS_AS(vdf::appinfo_reader(path.string()), std::runtime_error);
+
+    auto truncated = appinfo_v28({1});
+    truncated.resize(truncated.size() - 10);
+    write_file("vdf_test_appinfo_bad.vdf", truncated);
+    CHECK_THROWS_AS(vdf::appinfo_reader(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+}
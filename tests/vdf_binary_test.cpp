@@ -0,0 +1,322 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <vdf_binary.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+// builds binary KeyValues for the tests
+struct binary_builder
+{
+    std::string data;
+
+    binary_builder &type(vdf::binary_type t)
+    {
+        data += static_cast<char>(t);
+        return *this;
+    }
+    binary_builder &cstr(const std::string &s)
+    {
+        data += s;
+        data += '\0';
+        return *this;
+    }
+    binary_builder &u32(std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            data += static_cast<char>((v >> (8 * i)) & 0xFF);
+        return *this;
+    }
+    binary_builder &u64(std::uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            data += static_cast<char>((v >> (8 * i)) & 0xFF);
+        return *this;
+    }
+    binary_builder &begin(const std::string &name)
+    {
+        return type(vdf::binary_type::object).cstr(name);
+    }
+    binary_builder &end() { return type(vdf::binary_type::end); }
+    binary_builder &str(const std::string &key, const std::string &value)
+    {
+        return type(vdf::binary_type::string).cstr(key).cstr(value);
+    }
+    binary_builder &int32(const std::string &key, std::int32_t value)
+    {
+        return type(vdf::binary_type::int32)
+            .cstr(key)
+            .u32(static_cast<std::uint32_t>(value));
+    }
+    binary_builder &float32(const std::string &key, float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return type(vdf::binary_type::float32).cstr(key).u32(bits);
+    }
+    binary_builder &uint64(const std::string &key, std::uint64_t value)
+    {
+        return type(vdf::binary_type::uint64).cstr(key).u64(value);
+    }
+
+    const char *first() const { return data.data(); }
+    const char *last() const { return data.data() + data.size(); }
+};
+
+binary_builder shortcuts()
+{
+    binary_builder b;
+    b.begin("shortcuts")
+        .begin("0")
+        .int32("appid", -1234)
+        .str("AppName", "My Game")
+        .str("Exe", "\"C:\\Games\\game.exe\"")
+        .int32("IsHidden", 0)
+        .float32("Scale", 1.5f)
+        .uint64("LastPlayed", 18446744073709551615ull)
+        .type(vdf::binary_type::wstring)
+        .cstr("Unicode")
+        .data += std::string("\xE4\x00\x3D\xD8\x00\xDE\x00\x00", 8);
+    b.begin("tags").str("0", "favorite").str("1", "rpg").end();
+    b.end().end().end();
+    return b;
+}
+} // namespace
+
+TEST_CASE("read binary")
+{
+    const auto b = shortcuts();
+    auto obj = vdf::read_binary(b.first(), b.last());
+
+    CHECK(obj.name == "shortcuts");
+    REQUIRE(obj.childs.size() == 1);
+    const auto &game = obj.childs.at("0");
+    CHECK(game->attribs.at("appid") == "-1234");
+    CHECK(game->attribs.at("AppName") == "My Game");
+    CHECK(game->attribs.at("Exe") == "\"C:\\Games\\game.exe\"");
+    CHECK(game->attribs.at("IsHidden") == "0");
+    CHECK(game->attribs.at("Scale") == "1.5");
+    CHECK(game->attribs.at("LastPlayed") == "18446744073709551615");
+    CHECK(game->attribs.at("Unicode") == "\xC3\xA4\xF0\x9F\x98\x80");
+
+    REQUIRE(game->childs.size() == 1);
+    const auto &tags = game->childs.at("tags");
+    CHECK(tags->attribs.size() == 2);
+    CHECK(tags->attribs.at("1") == "rpg");
+}
+
+TEST_CASE("read binary multikey and custom output")
+{
+    binary_builder b;
+    b.begin("root").str("k", "a").str("k", "b").begin("c").end().end();
+
+    auto multi = vdf::read_binary<vdf::multikey_object>(b.first(), b.last());
+    CHECK(multi.attribs.count("k") == 2);
+    CHECK(multi.childs.count("c") == 1);
+
+    struct counter
+    {
+        size_t num_attributes = 0;
+        void add_attribute(std::string, std::string) { ++num_attributes; }
+        void add_child(std::unique_ptr<counter> child)
+        {
+            num_attributes += child->num_attributes;
+        }
+        void set_name(std::string) {}
+    };
+    const auto b2 = shortcuts();
+    CHECK(vdf::read_binary<counter>(b2.first(), b2.last()).num_attributes ==
+          9);
+}
+
+TEST_CASE("read binary from stream")
+{
+    std::istringstream in(shortcuts().data);
+    bool ok = false;
+    auto obj = vdf::read_binary(in, &ok);
+    CHECK(ok);
+    CHECK(obj.childs.at("0")->attribs.at("AppName") == "My Game");
+}
+
+TEST_CASE("read binary errors")
+{
+    const auto b = shortcuts();
+    // every prefix of the data misses at least one end marker
+    for (size_t len = 1; len + 1 < b.data.size(); ++len)
+    {
+        CAPTURE(len);
+        std::error_code ec;
+        auto obj = vdf::read_binary(b.first(), b.first() + len, ec);
+        CHECK(ec == std::errc::protocol_error);
+    }
+
+    binary_builder unknown;
+    unknown.begin("root").type(static_cast<vdf::binary_type>(0x42)).cstr("k");
+    CHECK_THROWS_AS(vdf::read_binary(unknown.first(), unknown.last()),
+                    std::runtime_error);
+
+    binary_builder no_object;
+    no_object.str("k", "v");
+    bool ok = true;
+    vdf::read_binary(no_object.first(), no_object.last(), &ok);
+    CHECK(!ok);
+}
+
+/////////////////////////////////////////////////////////////
+// binary write test
+/////////////////////////////////////////////////////////////
+
+namespace
+{
+bool equal(const vdf::object &lhs, const vdf::object &rhs)
+{
+    if (lhs.name != rhs.name || lhs.attribs != rhs.attribs ||
+        lhs.childs.size() != rhs.childs.size())
+        return false;
+    for (const auto &c : lhs.childs)
+    {
+        const auto other = rhs.childs.find(c.first);
+        if (other == rhs.childs.end() || !equal(*c.second, *other->second))
+            return false;
+    }
+    return true;
+}
+} // namespace
+
+TEST_CASE("write binary text round trip")
+{
+    std::ifstream file("DST_Manifest.acf");
+    const auto text = vdf::read(file);
+
+    std::ostringstream out;
+    vdf::write_binary(out, text);
+    const std::string data = out.str();
+    CHECK(data.back() == static_cast<char>(vdf::binary_type::end));
+
+    const auto binary =
+        vdf::read_binary(data.data(), data.data() + data.size());
+    CHECK(equal(text, binary));
+}
+
+TEST_CASE("write binary with type hints")
+{
+    vdf::object obj;
+    obj.name = "0";
+    obj.attribs["appid"] = "-1234";
+
+    vdf::BinaryWriteOptions opts;
+    opts.type_hints["appid"] = vdf::binary_type::int32;
+
+    std::string data;
+    vdf::write_binary(data, obj, opts);
+    binary_builder expected;
+    expected.begin("0").int32("appid", -1234).end().end();
+    CHECK(data == expected.data);
+
+    obj.attribs["Scale"] = "1.5";
+    obj.attribs["LastPlayed"] = "18446744073709551615";
+    obj.attribs["Color"] = "4294967295";
+    obj.attribs["Unicode"] = "\xC3\xA4\xF0\x9F\x98\x80";
+    opts.type_hints["Scale"] = vdf::binary_type::float32;
+    opts.type_hints["LastPlayed"] = vdf::binary_type::uint64;
+    opts.type_hints["Color"] = vdf::binary_type::color;
+    opts.type_hints["Unicode"] = vdf::binary_type::wstring;
+    data.clear();
+    vdf::write_binary(data, obj, opts);
+    const auto back = vdf::read_binary(data.data(), data.data() + data.size());
+    CHECK(back.attribs.at("appid") == "-1234");
+    CHECK(back.attribs.at("Scale") == "1.5");
+    CHECK(back.attribs.at("LastPlayed") == "18446744073709551615");
+    CHECK(back.attribs.at("Color") == "-1");
+    CHECK(back.attribs.at("Unicode") == "\xC3\xA4\xF0\x9F\x98\x80");
+
+    // invalid UTF-8 is written as U+FFFD, one per byte like to_utf16()
+    obj.attribs["Unicode"] = "a\xFF\xED\xA0\x80";
+    data.clear();
+    vdf::write_binary(data, obj, opts);
+    CHECK(vdf::read_binary(data.data(), data.data() + data.size())
+              .attribs.at("Unicode") == "a" + vdf::to_utf8(u"\uFFFD\uFFFD"
+                                                           u"\uFFFD\uFFFD"));
+
+    for (const char *invalid : {"2147483648", "12a", "", "-"})
+    {
+        CAPTURE(invalid);
+        obj.attribs["appid"] = invalid;
+        CHECK_THROWS_AS(vdf::write_binary(data, obj, opts), std::runtime_error);
+    }
+}
+
+TEST_CASE("binary non-finite floats round trip")
+{
+    binary_builder in;
+    in.begin("0")
+        .float32("inf", std::numeric_limits<float>::infinity())
+        .float32("-inf", -std::numeric_limits<float>::infinity())
+        .float32("nan", std::numeric_limits<float>::quiet_NaN())
+        .float32("-nan", -std::numeric_limits<float>::quiet_NaN())
+        .end()
+        .end();
+    const auto obj =
+        vdf::read_binary(in.data.data(), in.data.data() + in.data.size());
+    vdf::BinaryWriteOptions opts;
+    for (const auto &i : obj.attribs)
+    {
+        CHECK(i.first == i.second);
+        opts.type_hints[i.first] = vdf::binary_type::float32;
+    }
+
+    std::string data;
+    vdf::write_binary(data, obj, opts);
+    const auto back =
+        vdf::read_binary(data.data(), data.data() + data.size());
+    CHECK(back.attribs == obj.attribs);
+}
+
+namespace
+{
+/// destroys a chain of objects without recursing through the destructors
+void dismantle(vdf::object &root)
+{
+    auto childs = std::move(root.childs);
+    while (!childs.empty())
+    {
+        auto next = std::move(childs.begin()->second->childs);
+        childs = std::move(next);
+    }
+}
+} // namespace
+
+TEST_CASE("write binary deep trees")
+{
+    // deep enough to overflow the call stack of a recursive writer
+    const size_t depth = 200000;
+    vdf::object root;
+    root.name = "0";
+    vdf::object *cur = &root;
+    for (size_t i = 1; i < depth; ++i)
+    {
+        auto child = std::make_shared<vdf::object>();
+        child->name = std::to_string(i);
+        cur->childs.emplace(child->name, child);
+        cur = child.get();
+    }
+
+    std::string data;
+    vdf::write_binary(data, root);
+    auto back = vdf::read_binary(data.data(), data.data() + data.size());
+    size_t back_depth = 1;
+    for (const vdf::object *obj = &back; !obj->childs.empty();
+         obj = obj->childs.begin()->second.get())
+        ++back_depth;
+    CHECK(back_depth == depth);
+
+    dismantle(back);
+    dismantle(root);
+}
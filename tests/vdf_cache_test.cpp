@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vdf_cache.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+void write_file(const std::filesystem::path &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+} // namespace
+
+TEST_CASE("parse cache")
+{
+    const auto dir = std::filesystem::temp_directory_path() / "vdf_test_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "file.vdf";
+    write_file(path, "\"root\" { \"key\" \"value\" }");
+
+    {
+        vdf::parse_cache cache(vdf::Options{}, dir.string());
+        const auto first = cache.get(path.string());
+        CHECK(first->name == "root");
+        CHECK(first->attribs.at("key") == "value");
+        CHECK(cache.statistics().misses == 1);
+
+        const auto second = cache.get(path.string());
+        CHECK(second == first);
+        CHECK(cache.statistics().hits == 1);
+        CHECK(cache.statistics().bytes_saved ==
+              std::filesystem::file_size(path));
+        CHECK(cache.size() == 1);
+
+        // a changed file is parsed again
+        write_file(path, "\"root\" { \"key\" \"changed\" }");
+        std::filesystem::last_write_time(
+            path, std::filesystem::last_write_time(path) +
+                      std::chrono::seconds(1));
+        const auto third = cache.get(path.string());
+        CHECK(third->attribs.at("key") == "changed");
+        CHECK(cache.statistics().misses == 2);
+
+        cache.clear();
+        CHECK(cache.size() == 0);
+    }
+    {
+        // a new cache loads the stored tree from the cache directory
+        vdf::parse_cache cache(vdf::Options{}, dir.string());
+        const auto obj = cache.get(path.string());
+        CHECK(obj->attribs.at("key") == "changed");
+        CHECK(cache.statistics().disk_hits == 1);
+        CHECK(cache.statistics().misses == 0);
+    }
+    {
+        // hashes are computed again for stored trees
+        vdf::Options opt;
+        opt.compute_hashes = true;
+        vdf::parse_cache cache(opt, dir.string());
+        const auto obj = cache.get(path.string());
+        CHECK(cache.statistics().disk_hits == 1);
+        const std::string text = "\"root\" { \"key\" \"changed\" }";
+        CHECK(obj->hash == vdf::read(text.begin(), text.end(), opt).hash);
+    }
+    {
+        // different options do not share the stored trees
+        vdf::Options opt;
+        opt.strip_escape_symbols = false;
+        vdf::multikey_parse_cache cache(opt, dir.string());
+        CHECK(cache.get(path.string())->attribs.count("key") == 1);
+        CHECK(cache.statistics().misses == 1);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache with detected encodings")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_encoding";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "latin1.vdf";
+    write_file(path, "\"root\" { \"key\" \"\xE4\xF6\xFC\xDF\" }");
+    const std::string utf8 = "\xC3\xA4\xC3\xB6\xC3\xBC\xC3\x9F";
+
+    vdf::Options opt;
+    opt.detect_encoding = true;
+    std::ifstream file(path, std::ios::binary);
+    CHECK(vdf::read(file, opt).attribs.at("key") == utf8);
+
+    vdf::parse_cache cache(opt, dir.string());
+    CHECK(cache.get(path.string())->attribs.at("key") == utf8);
+
+    // trees stored with and without detection are not shared
+    vdf::parse_cache raw(vdf::Options{}, dir.string());
+    CHECK(raw.get(path.string())->attribs.at("key").size() == 4);
+    CHECK(raw.statistics().misses == 1);
+    vdf::parse_cache detecting(opt, dir.string());
+    CHECK(detecting.get(path.string())->attribs.at("key") == utf8);
+    CHECK(detecting.statistics().misses == 1);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache with utf8 validation")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_utf8";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "invalid.vdf";
+    write_file(path, "\"root\" { \"key\" \"\xFF\" }");
+
+    vdf::parse_cache(vdf::Options{}, dir.string()).get(path.string());
+
+    // the tree stored without validation is not used
+    vdf::Options opt;
+    opt.validate_utf8 = true;
+    vdf::parse_cache validating(opt, dir.string());
+    CHECK_THROWS_AS(validating.get(path.string()), vdf::parse_error);
+    CHECK(validating.statistics().disk_hits == 0);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache with error recovery")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_recovery";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "broken.vdf";
+    write_file(path, "\"root\" { \"key\" \"value\" } }");
+
+    vdf::Options opt;
+    opt.recover_errors = true;
+    vdf::parse_cache recovering(opt, dir.string());
+    CHECK(recovering.get(path.string())->attribs.at("key") == "value");
+
+    // the recovered tree is not used by a strict cache
+    vdf::parse_cache strict(vdf::Options{}, dir.string());
+    CHECK_THROWS_AS(strict.get(path.string()), vdf::parse_error);
+    CHECK(strict.statistics().disk_hits == 0);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache with a corrupted cache file")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_corrupted";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "file.vdf";
+    write_file(path, "\"root\" { \"child\" { \"key\" \"value\" } }");
+    vdf::parse_cache(vdf::Options{}, dir.string()).get(path.string());
+
+    // let the child of the stored snapshot refer to its root
+    std::filesystem::path stored;
+    for (const auto &f : std::filesystem::directory_iterator(dir))
+        if (f.path().extension() == ".vdfcache")
+            stored = f.path();
+    REQUIRE(!stored.empty());
+    std::string data;
+    {
+        std::ifstream in(stored, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    }
+    auto load = [&data](size_t pos)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < 8; ++i)
+            v |= uint64_t(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        return static_cast<size_t>(v);
+    };
+    const size_t snap = 48 + load(40);
+    const size_t root = load(snap + 16);
+    const size_t child_entry = snap + load(snap + root + 40);
+    data.replace(child_entry + 16, 8, data, snap + 16, 8);
+    write_file(stored, data);
+
+    // the corrupted file is a miss
+    vdf::parse_cache cache(vdf::Options{}, dir.string());
+    const auto obj = cache.get(path.string());
+    CHECK(obj->childs.at("child")->attribs.at("key") == "value");
+    CHECK(cache.statistics().disk_hits == 0);
+    CHECK(cache.statistics().misses == 1);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache instances sharing a directory")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_shared";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "file.vdf";
+    write_file(path, "\"root\" { \"key\" \"value\" }");
+
+    // every instance parses and stores the same file at the same time
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+        threads.emplace_back(
+            [&]
+            {
+                vdf::parse_cache cache(vdf::Options{}, dir.string());
+                CHECK(cache.get(path.string())->attribs.at("key") ==
+                      "value");
+            });
+    for (auto &t : threads)
+        t.join();
+
+    size_t cache_files = 0;
+    for (const auto &f : std::filesystem::directory_iterator(dir))
+    {
+        CHECK(f.path().extension() != ".tmp");
+        if (f.path().extension() == ".vdfcache")
+            ++cache_files;
+    }
+    CHECK(cache_files == 1);
+
+    vdf::parse_cache cache(vdf::Options{}, dir.string());
+    CHECK(cache.get(path.string())->attribs.at("key") == "value");
+    CHECK(cache.statistics().disk_hits == 1);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("parse cache errors")
+{
+    vdf::parse_cache cache;
+    CHECK_THROWS_AS(cache.get("does_not_exist.vdf"), std::system_error);
+
+    std::error_code ec;
+    CHECK(cache.get("does_not_exist.vdf", ec) == nullptr);
+    CHECK(ec);
+
+    const auto path =
+        std::filesystem::temp_directory_path() / "vdf_test_cache_bad.vdf";
+    write_file(path, "\"root\" { \"key\" ");
+    CHECK_THROWS_AS(cache.get(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vdf_compact.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+TEST_CASE("compact wobject from wide and narrow text")
+{
+    const std::wstring wide =
+        L"\"root\" { \"a\" \"1\" \"umlaut\" \"\u00FC\u20AC\" \"sub\" { \"b\" "
+        L"\"2\" } }";
+    const std::string narrow = vdf::to_utf8(wide);
+
+    for (const auto &obj :
+         {vdf::read<vdf::compact_wobject>(wide.begin(), wide.end()),
+          vdf::read<vdf::compact_wobject>(narrow.begin(), narrow.end())})
+    {
+        CHECK(obj.name() == L"root");
+        CHECK(obj.attribute_count() == 2);
+        CHECK(obj.attribute(L"a") == L"1");
+        CHECK(obj.attribute(L"umlaut") == L"\u00FC\u20AC");
+        CHECK(obj.utf8_attribs().at("umlaut") == "\xC3\xBC\xE2\x82\xAC");
+        CHECK(obj.has_attribute(L"a"));
+        CHECK(!obj.has_attribute(L"b"));
+        CHECK_THROWS_AS(obj.attribute(L"b"), std::out_of_range);
+
+        REQUIRE(obj.has_child(L"sub"));
+        CHECK(obj.child_count() == 1);
+        CHECK(obj.child(L"sub").name() == L"sub");
+        CHECK(obj.child(L"sub").attribute(L"b") == L"2");
+
+        std::vector<std::wstring> keys;
+        obj.for_each_attribute([&keys](const std::wstring &key,
+                                       const std::wstring &)
+                               { keys.push_back(key); });
+        CHECK(keys.size() == 2);
+        obj.for_each_child([](const std::wstring &key,
+                              const vdf::compact_wobject &child)
+                           { CHECK(key == child.name()); });
+
+        const vdf::wobject w = obj.to_wobject();
+        CHECK(w.name == L"root");
+        CHECK(w.attribs.at(L"umlaut") == L"\u00FC\u20AC");
+        CHECK(w.childs.at(L"sub")->attribs.at(L"b") == L"2");
+    }
+}
+
+TEST_CASE("compact wobject concurrent reads")
+{
+    const std::string text =
+        "\"root\" { \"a\" \"1\" \"b\" \"2\" \"c\" \"3\" \"d\" \"4\" \"e\" "
+        "\"5\" }";
+    const auto obj = vdf::read<vdf::compact_wobject>(text.begin(), text.end());
+
+    // the values are returned by value, earlier results stay valid
+    const std::wstring a = obj.attribute(L"a");
+    const std::wstring keys = L"abcde";
+    for (wchar_t key : keys)
+        CHECK(obj.attribute(std::wstring(1, key)) ==
+              std::wstring(1, static_cast<wchar_t>(key - L'a' + L'1')));
+    CHECK(a == L"1");
+
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches(0);
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                for (int i = 0; i < 1000; ++i)
+                    for (wchar_t key : keys)
+                        if (obj.attribute(std::wstring(1, key)) !=
+                                std::wstring(1, static_cast<wchar_t>(
+                                                    key - L'a' + L'1')) ||
+                            obj.name() != L"root")
+                            ++mismatches;
+            });
+    for (auto &t : threads)
+        t.join();
+    CHECK(mismatches == 0);
+
+    // copies and renames are independent
+    vdf::compact_wobject copy = obj;
+    copy.set_name(std::wstring(L"other"));
+    CHECK(copy.name() == L"other");
+    CHECK(obj.name() == L"root");
+    vdf::compact_wobject moved = std::move(copy);
+    CHECK(moved.name() == L"other");
+}
+
+TEST_CASE("compact wobject from file")
+{
+    std::wifstream file("DST_Manifest.acf");
+    const auto root = vdf::read<vdf::compact_wobject>(file);
+    REQUIRE(root.has_child(L"AppState"));
+    const auto &obj = root.child(L"AppState");
+    CHECK(obj.attribute_count() == 25);
+    CHECK(obj.attribute(L"appid") == L"343050");
+    CHECK(obj.child(L"BaseInclude").attribute(L"BaseAttrib") == L"Yes");
+}
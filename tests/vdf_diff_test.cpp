@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <vdf_diff.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+template <typename T> T parse(const std::string &text)
+{
+    vdf::Options opt;
+    opt.compute_hashes = true;
+    return vdf::read<T>(text.begin(), text.end(), opt);
+}
+
+/// changes as sorted strings, e.g. "changed a/b 1 2"
+template <typename T>
+std::vector<std::string> describe(const std::vector<vdf::basic_change<T>> &cs)
+{
+    std::vector<std::string> result;
+    for (const auto &c : cs)
+    {
+        std::string s = c.type == vdf::change_type::added     ? "added "
+                        : c.type == vdf::change_type::removed ? "removed "
+                                                              : "changed ";
+        for (size_t i = 0; i < c.path.size(); ++i)
+            s += (i ? "/" : "") + c.path[i];
+        if (c.attribute)
+            s += " " + c.old_value + " " + c.new_value;
+        else
+            s += std::string(" ") + (c.old_child ? "old" : "") +
+                 (c.new_child ? "new" : "");
+        result.push_back(s);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+} // namespace
+
+TEST_CASE("diff trees")
+{
+    const auto before = parse<vdf::object>(
+        "\"r\" { \"a\" \"1\" \"b\" \"2\" \"c\" { \"x\" \"1\" \"d\" { \"y\" "
+        "\"1\" } } \"same\" { \"k\" \"v\" } \"gone\" { } }");
+    const auto after = parse<vdf::object>(
+        "\"r\" { \"a\" \"1\" \"b\" \"3\" \"new\" \"4\" \"c\" { \"d\" { \"y\" "
+        "\"2\" } } \"same\" { \"k\" \"v\" } \"added\" { \"z\" \"1\" } }");
+
+    const auto changes = vdf::diff(before, after);
+    CHECK(describe(changes) == std::vector<std::string>{
+                                   "added added new",
+                                   "added new  4",
+                                   "changed b 2 3",
+                                   "changed c/d/y 1 2",
+                                   "removed c/x 1 ",
+                                   "removed gone old",
+                                   });
+    for (const auto &c : changes)
+        if (c.type == vdf::change_type::added && !c.attribute)
+            CHECK(c.new_child->attribs.at("z") == "1");
+
+    CHECK(vdf::diff(before, before).empty());
+    CHECK(vdf::diff(after, before).size() == changes.size());
+}
+
+TEST_CASE("diff skips subtrees with equal hashes")
+{
+    auto before = parse<vdf::object>("\"r\" { \"c\" { \"x\" \"1\" } }");
+    auto after = parse<vdf::object>("\"r\" { \"c\" { \"x\" \"2\" } }");
+    CHECK(vdf::diff(before, after).size() == 1);
+
+    // a subtree is only visited if its hash changed
+    after.childs.at("c")->hash = before.childs.at("c")->hash;
+    after.hash = before.hash + 1;
+    CHECK(vdf::diff(before, after).empty());
+
+    // without hashes the trees are compared completely
+    after.childs.at("c")->hash = 0;
+    CHECK(vdf::diff(before, after).size() == 1);
+    before.hash = after.hash = 0;
+    after.childs.at("c")->attribs.at("x") = "1";
+    CHECK(vdf::diff(before, after).empty());
+}
+
+TEST_CASE("diff multikey trees")
+{
+    const auto before = parse<vdf::multikey_object>(
+        "\"r\" { \"k\" \"1\" \"k\" \"2\" \"c\" { \"x\" \"1\" } "
+        "\"c\" { \"x\" \"2\" } \"m\" \"1\" }");
+    const auto after = parse<vdf::multikey_object>(
+        "\"r\" { \"k\" \"1\" \"k\" \"3\" \"c\" { \"x\" \"1\" } "
+        "\"m\" \"1\" \"m\" \"5\" }");
+    CHECK(describe(vdf::diff(before, after)) ==
+          std::vector<std::string>{"added m  5", "changed k 2 3",
+                                   "removed c old"});
+}
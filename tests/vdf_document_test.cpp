@@ -0,0 +1,286 @@
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <vdf_document.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+std::string read_all(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+template <typename T> bool equal(const T &lhs, const T &rhs)
+{
+    if (lhs.name != rhs.name || lhs.attribs != rhs.attribs ||
+        lhs.childs.size() != rhs.childs.size())
+        return false;
+    for (const auto &c : lhs.childs)
+    {
+        const auto other = rhs.childs.find(c.first);
+        if (other == rhs.childs.end() || !equal(*c.second, *other->second))
+            return false;
+    }
+    return true;
+}
+
+/// the tree read() builds, without resolving includes
+vdf::object read_text(const std::string &text)
+{
+    vdf::Options opt;
+    opt.ignore_includes = true;
+    return vdf::read(text.begin(), text.end(), opt);
+}
+} // namespace
+
+TEST_CASE("document incremental edits")
+{
+    vdf::document doc(read_all("DST_Manifest.acf"));
+    CHECK(doc.valid());
+    CHECK(equal(doc.root(), read_text(doc.text())));
+
+    const auto &app = doc.root();
+    CHECK(app.name == "AppState");
+    const auto *user_config = app.childs.at("UserConfig").get();
+    const auto *depots = app.childs.at("MountedDepots").get();
+
+    // change a value inside of MountedDepots
+    const auto pos = doc.text().find("8201905585059905072");
+    REQUIRE(pos != std::string::npos);
+    CHECK(doc.edit(pos, 19, "42"));
+    CHECK(depots->attribs.at("343051") == "42");
+    CHECK(doc.reparsed() < 40);
+    CHECK(app.childs.at("UserConfig").get() == user_config);
+    CHECK(equal(doc.root(), read_text(doc.text())));
+
+    // add an object to UserConfig
+    const auto user_pos = doc.text().find("\"UserConfig\"");
+    const auto body = doc.text().find('{', user_pos) + 1;
+    CHECK(doc.edit(body, 0, "\"language\" \"german\" \"Sub\" { \"a\" \"b\" }"));
+    CHECK(user_config->attribs.at("language") == "german");
+    CHECK(user_config->childs.at("Sub")->attribs.at("a") == "b");
+    CHECK(app.childs.at("MountedDepots").get() == depots);
+    CHECK(equal(doc.root(), read_text(doc.text())));
+
+    // the ranges behind the edits moved along
+    const auto flags = doc.text().find("\"343051\"");
+    CHECK(doc.edit(flags + 1, 6, "1"));
+    CHECK(depots->attribs.count("1") == 1);
+    CHECK(equal(doc.root(), read_text(doc.text())));
+}
+
+TEST_CASE("document falls back to parents")
+{
+    vdf::document doc("\"root\" { \"a\" { \"k\" \"v\" } \"b\" { } }");
+    const auto *b = doc.root().childs.at("b").get();
+
+    // closing a in its body changes the structure of root
+    const auto pos = doc.text().find("\"k\"");
+    CHECK(doc.edit(pos, 0, "} \"c\" {"));
+    CHECK(doc.text() ==
+          "\"root\" { \"a\" { } \"c\" {\"k\" \"v\" } \"b\" { } }");
+    CHECK(doc.root().childs.at("a")->attribs.empty());
+    CHECK(doc.root().childs.at("c")->attribs.at("k") == "v");
+    // b behind the changed objects is kept
+    CHECK(doc.root().childs.at("b").get() == b);
+    CHECK(equal(doc.root(), read_text(doc.text())));
+
+    // unquoted words are extended like quoted ones
+    vdf::document words("\"root\" { \"a\" { k v } }");
+    const auto v = words.text().find(" v ") + 2;
+    CHECK(words.edit(v, 0, "w"));
+    CHECK(words.root().childs.at("a")->attribs.at("k") == "vw");
+    CHECK(equal(words.root(), read_text(words.text())));
+}
+
+TEST_CASE("document invalid edits")
+{
+    vdf::document doc("\"root\" { \"a\" \"b\" }");
+    CHECK(!doc.edit(doc.text().find("\"b\""), 0, "\""));
+    CHECK(!doc.valid());
+    CHECK(doc.root().attribs.at("a") == "b");
+
+    CHECK(doc.edit(doc.text().find("\"b\"") - 1, 1, ""));
+    CHECK(doc.valid());
+    CHECK(equal(doc.root(), read_text(doc.text())));
+
+    CHECK_THROWS_AS(doc.edit(doc.text().size() + 1, 0, "x"),
+                    std::out_of_range);
+    CHECK_THROWS_AS(vdf::document("\"root\" { \"a\" }"), std::runtime_error);
+}
+
+TEST_CASE("document tokens like read")
+{
+    // a backslash does not escape the whitespace behind it, if it is the
+    // first character of a word. Braces, which cannot start the expected
+    // token, are words
+    const std::string text =
+        "\"root\" { \"lang\" \"en\" \"sub\" { \"a\" \"b\" } }";
+    vdf::document doc(text);
+    CHECK(doc.edit(text.find("\"en\""), 0, "\\\t"));
+    CHECK(equal(doc.root(), read_text(doc.text())));
+    CHECK(doc.root().attribs.at("lang") == "\\");
+    CHECK(doc.root().attribs.at("{") == "a");
+
+    const std::string comment = "\"root\" { \"k\" \"v\" {// c\n }";
+    CHECK(equal(vdf::document(comment).root(), read_text(comment)));
+}
+
+TEST_CASE("document random edits")
+{
+    std::mt19937 rng(1234);
+    const std::string alphabet = "ab \"{}\n\\";
+    vdf::document doc("\"root\" { \"a\" { \"k\" \"v\" \"x\" { } } \"b\" \"c\" "
+                      "\"d\" { \"e\" \"f\" } }");
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto &text = doc.text();
+        std::uniform_int_distribution<size_t> offset(0, text.size());
+        const size_t pos = offset(rng);
+        const size_t removed =
+            std::min<size_t>(text.size() - pos, rng() % 3);
+        const std::string inserted(1, alphabet[rng() % alphabet.size()]);
+        const std::string old = text.substr(pos, removed);
+        const bool valid = doc.edit(pos, removed, inserted);
+
+        bool ok = false;
+        vdf::Options opt;
+        opt.ignore_includes = true;
+        const auto expected = vdf::read(text.begin(), text.end(), &ok, opt);
+        CAPTURE(text);
+        if (valid && ok)
+            CHECK(equal(doc.root(), expected));
+        // keep the text mostly valid
+        if (!valid || !ok)
+            CHECK(doc.edit(pos, inserted.size(), old));
+    }
+}
+
+TEST_CASE("document edits in wide objects")
+{
+    // the work for an edit does not depend on the number of siblings
+    std::vector<size_t> reparsed;
+    for (const size_t width : {size_t(100), size_t(10000)})
+    {
+        std::string text = "\"Tokens\" {\n";
+        for (size_t i = 0; i < width; ++i)
+            text += "\t\"key" + std::to_string(i) + "\" \"value" +
+                    std::to_string(i) + "\"\n";
+        text += "}\n";
+        vdf::document doc(text);
+        const auto &tokens = doc.root();
+
+        // change a value in the middle
+        const auto value = doc.text().find("\"value50\"");
+        CHECK(doc.edit(value + 1, 7, "changed"));
+        CHECK(tokens.attribs.at("key50") == "changed");
+        reparsed.push_back(doc.reparsed());
+
+        // add and remove a pair in the middle
+        const auto key = doc.text().find("\t\"key60\"");
+        CHECK(doc.edit(key, 0, "\t\"added\" { \"a\" \"b\" }\n"));
+        CHECK(tokens.childs.at("added")->attribs.at("a") == "b");
+        reparsed.push_back(doc.reparsed());
+        CHECK(doc.edit(doc.text().find("\"key70\""), 17, ""));
+        CHECK(tokens.attribs.count("key70") == 0);
+        reparsed.push_back(doc.reparsed());
+
+        // the pairs behind the edits moved along
+        const auto last = doc.text().find(
+            "\"value" + std::to_string(width - 1) + "\"");
+        CHECK(doc.edit(last + 1, 0, "x"));
+        CHECK(tokens.attribs.at("key" + std::to_string(width - 1)) ==
+              "xvalue" + std::to_string(width - 1));
+        CHECK(equal(doc.root(), read_text(doc.text())));
+    }
+    REQUIRE(reparsed.size() == 6);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        CHECK(reparsed[i] < 64);
+        CHECK(reparsed[i] == reparsed[i + 3]);
+    }
+}
+
+TEST_CASE("document random edits like a new document")
+{
+    std::mt19937 rng(4321);
+    const std::string alphabet = "ab \"{}\n\\[]$!/*#";
+    vdf::Options opt;
+    opt.compute_hashes = true;
+    vdf::document doc("\"root\" { \"a\" { \"k\" \"v\" \"x\" { } } \"b\" \"c\" "
+                      "\"d\" { \"e\" \"f\" \"g\" \"h\" } \"a\" \"i\" } "
+                      "\"second\" { }",
+                      opt);
+    for (int i = 0; i < 5000; ++i)
+    {
+        const auto &text = doc.text();
+        std::uniform_int_distribution<size_t> offset(0, text.size());
+        const size_t pos = offset(rng);
+        const size_t removed =
+            std::min<size_t>(text.size() - pos, rng() % 3);
+        const std::string inserted(1, alphabet[rng() % alphabet.size()]);
+        const std::string old = text.substr(pos, removed);
+        const bool valid = doc.edit(pos, removed, inserted);
+
+        CAPTURE(text);
+        try
+        {
+            const vdf::document expected(text, opt);
+            CHECK(valid);
+            CHECK(equal(doc.root(), expected.root()));
+            CHECK(doc.root().hash == expected.root().hash);
+        }
+        catch (std::runtime_error &)
+        {
+            CHECK(!valid);
+            CHECK(doc.edit(pos, inserted.size(), old));
+        }
+    }
+}
+
+TEST_CASE("document hashes")
+{
+    vdf::Options opt;
+    opt.compute_hashes = true;
+    opt.ignore_includes = true;
+    vdf::document doc(read_all("DST_Manifest.acf"), opt);
+    const auto user_config = doc.root().childs.at("UserConfig")->hash;
+
+    const auto pos = doc.text().find("8201905585059905072");
+    CHECK(doc.edit(pos, 19, "42"));
+    const auto expected =
+        vdf::read(doc.text().begin(), doc.text().end(), opt);
+    CHECK(doc.root().hash == expected.hash);
+    CHECK(doc.root().childs.at("MountedDepots")->hash ==
+          expected.childs.at("MountedDepots")->hash);
+    CHECK(doc.root().childs.at("UserConfig")->hash == user_config);
+}
+
+TEST_CASE("multikey document")
+{
+    vdf::multikey_document doc(
+        "\"root\" { \"a\" { \"k\" \"1\" } \"a\" { \"k\" \"2\" } }");
+    CHECK(doc.root().childs.count("a") == 2);
+
+    const auto pos = doc.text().find("\"2\"");
+    CHECK(doc.edit(pos + 1, 1, "3"));
+    CHECK(doc.reparsed() < 12);
+    bool found = false;
+    const auto same_name = doc.root().childs.equal_range("a");
+    for (auto it = same_name.first; it != same_name.second; ++it)
+        found = found || it->second->attribs.find("k")->second == "3";
+    CHECK(found);
+
+    vdf::wdocument wdoc(L"\"root\" { \"a\" \"b\" }");
+    CHECK(wdoc.edit(wdoc.text().find(L"b"), 1, L"c"));
+    CHECK(wdoc.root().attribs.at(L"a") == L"c");
+}
@@ -0,0 +1,73 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <vdf_parallel.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+vdf::object generate_tree(size_t depth, size_t childs)
+{
+    vdf::object obj;
+    obj.name = "node" + std::to_string(depth);
+    for (size_t i = 0; i < 5; ++i)
+        obj.attribs["key" + std::to_string(i)] = "value \"" + std::to_string(i);
+    if (depth > 0)
+        for (size_t i = 0; i < childs; ++i)
+        {
+            auto child = std::make_unique<vdf::object>(
+                generate_tree(depth - 1, childs));
+            child->name += "_" + std::to_string(i);
+            obj.add_child(std::move(child));
+        }
+    return obj;
+}
+} // namespace
+
+TEST_CASE("parallel write is identical")
+{
+    const auto obj = generate_tree(4, 5);
+    for (const bool compact : {false, true})
+    {
+        vdf::WriteOptions opts;
+        opts.compact = compact;
+        std::string expected;
+        vdf::write(expected, obj, opts);
+        for (unsigned threads : {1u, 2u, 3u, 8u, 64u})
+        {
+            CAPTURE(compact);
+            CAPTURE(threads);
+            std::string str("prefix");
+            vdf::write_parallel(str, obj, opts, threads);
+            CHECK(str == "prefix" + expected);
+        }
+    }
+
+    std::stringstream stream;
+    vdf::write_parallel(stream, obj);
+    const auto test_obj = vdf::read(stream);
+    CHECK(test_obj.childs.size() == 5);
+}
+
+TEST_CASE("parallel write small trees")
+{
+    std::ifstream file("DST_Manifest.acf");
+    const auto multikey = vdf::read<vdf::multikey_object>(file);
+    std::string expected;
+    vdf::write(expected, multikey);
+    std::string str;
+    vdf::write_parallel(str, multikey, {}, 4);
+    CHECK(str == expected);
+
+    vdf::object leaf;
+    leaf.name = "leaf";
+    leaf.attribs["key"] = "value";
+    expected.clear();
+    vdf::write(expected, leaf);
+    str.clear();
+    vdf::write_parallel(str, leaf, {}, 4);
+    CHECK(str == expected);
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -212,6 +213,327 @@ TEST_CASE_TEMPLATE("read broken file throw", charT, char, wchar_t)
     CHECK_THROWS(vdf::read(file));
 }
 
+TEST_CASE_TEMPLATE("error positions", charT, char, wchar_t)
+{
+    const std::basic_string<charT> text =
+        T_L("\"root\"\n{\n\t\"a\" \"b\"\n\t}\n}\n");
+    size_t offset = 0;
+    try
+    {
+        vdf::read(text.begin(), text.end());
+    }
+    catch (vdf::parse_error &e)
+    {
+        offset = e.offset();
+    }
+    CHECK(offset == text.rfind(T_L('}')));
+    const auto pos = vdf::position_of(text, offset);
+    CHECK(pos.line == 5);
+    CHECK(pos.column == 1);
+
+    std::error_code ec;
+    size_t error_offset = 0;
+    vdf::read(text.begin(), text.end(), ec, error_offset);
+    CHECK(ec == std::errc::protocol_error);
+    CHECK(error_offset == offset);
+
+    const std::basic_string<charT> quote = T_L("\"root\" {\n  \"key");
+    vdf::read(quote.begin(), quote.end(), ec, error_offset);
+    CHECK(ec);
+    CHECK(vdf::position_of(quote, error_offset).line == 2);
+    CHECK(vdf::position_of(quote, error_offset).column == 3);
+
+    const std::basic_string<charT> valid = T_L("\"root\" { }");
+    vdf::read(valid.begin(), valid.end(), ec, error_offset);
+    CHECK(!ec);
+    CHECK(error_offset == 0);
+}
+
+TEST_CASE_TEMPLATE("error recovery", charT, char, wchar_t)
+{
+    vdf::Options opt;
+    opt.recover_errors = true;
+    std::vector<vdf::diagnostic> diagnostics;
+
+    // key without value and stray brace, the rest is kept
+    const std::basic_string<charT> text =
+        T_L("\"root\"\n{\n\t\"a\" \"1\"\n\t\"b\" // c\n}\n}\n"
+            "\"next\" { \"c\" \"3\" \"d\" {");
+    auto objs = vdf::read(text.begin(), text.end(), diagnostics, opt);
+    REQUIRE(diagnostics.size() == 3);
+    CHECK(std::string(diagnostics[0].message) ==
+          "key declared, but no value");
+    CHECK(diagnostics[0].offset == text.find(T_L('}')));
+    CHECK(std::string(diagnostics[1].message) == "unexpected '}'");
+    CHECK(vdf::position_of(text, diagnostics[1].offset).line == 6);
+    CHECK(std::string(diagnostics[2].message) ==
+          "object is not closed with '}'");
+    CHECK(diagnostics[2].offset == text.size());
+    // two roots
+    REQUIRE(objs.childs.size() == 2);
+    const auto &root = objs.childs.at(T_L("root"));
+    CHECK(root->attribs.at(T_L("a")) == T_L("1"));
+    CHECK(root->attribs.count(T_L("b")) == 0);
+    const auto &next = objs.childs.at(T_L("next"));
+    CHECK(next->attribs.at(T_L("c")) == T_L("3"));
+    CHECK(next->childs.count(T_L("d")) == 1);
+
+    // without diagnostics, the errors are skipped silently
+    auto quiet = vdf::read(text.begin(), text.end(), opt);
+    CHECK(quiet.childs.size() == 2);
+
+    // unclosed quote keeps everything in front of it
+    diagnostics.clear();
+    const std::basic_string<charT> quote =
+        T_L("\"root\" { \"a\" \"1\" \"b\" \"2");
+    auto r = vdf::read(quote.begin(), quote.end(), diagnostics, opt);
+    REQUIRE(diagnostics.size() == 2);
+    CHECK(diagnostics[0].offset == quote.rfind(T_L('"')));
+    CHECK(r.name == T_L("root"));
+    CHECK(r.attribs.size() == 1);
+
+    // without recovery, parsing stops at the first error
+    diagnostics.clear();
+    r = vdf::read(text.begin(), text.end(), diagnostics);
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].offset == text.find(T_L('}')));
+    CHECK(r.name.empty());
+    CHECK(r.childs.empty());
+    CHECK(r.attribs.empty());
+
+    diagnostics.clear();
+    const std::basic_string<charT> valid = T_L("\"root\" { \"a\" \"b\" }");
+    r = vdf::read(valid.begin(), valid.end(), diagnostics, opt);
+    CHECK(diagnostics.empty());
+    CHECK(r.attribs.size() == 1);
+}
+
+TEST_CASE("count newlines")
+{
+    // crosses the block size of the vectorized count
+    std::string text;
+    for (size_t i = 0; i < 10000; ++i)
+        text += std::string(i % 37, 'x') + "\n";
+    for (size_t n : {size_t{0}, size_t{15}, size_t{16}, size_t{4097},
+                     size_t{65000}, text.size()})
+    {
+        CHECK(vdf::position_of(text, n).line ==
+              1 + static_cast<size_t>(
+                      std::count(text.data(), text.data() + n, '\n')));
+    }
+    CHECK(vdf::position_of(text, text.size() + 10).line == 10001);
+    CHECK(vdf::position_of(std::string("ab\ncd"), 4).column == 2);
+}
+
+// bytes of text in UTF-16 with a byte order mark
+static std::string utf16_bytes(const std::u16string &text, bool big_endian)
+{
+    std::string bytes;
+    for (char16_t c : std::u16string(1, u'\xFEFF') + text)
+    {
+        const char lo = static_cast<char>(c & 0xFF);
+        const char hi = static_cast<char>(c >> 8);
+        bytes += big_endian ? hi : lo;
+        bytes += big_endian ? lo : hi;
+    }
+    return bytes;
+}
+
+TEST_CASE("read utf16")
+{
+    // long enough for the vectorized ASCII path, with 2, 3 and 4 byte
+    // characters in between
+    const std::u16string text =
+        u"\"lang\" { \"Language\" \"english\" \"Tokens\" { "
+        u"\"menu_title\" \"Gr\u00FC\u00DFe \u20AC \U0001F600 and some more "
+        u"ascii text\" \"broken\" \"a\xD800" u"b\" } }";
+    for (bool big_endian : {false, true})
+    {
+        const std::string bytes = utf16_bytes(text, big_endian);
+        const auto obj =
+            vdf::read_utf16(bytes.data(), bytes.data() + bytes.size());
+        CHECK(obj.name == "lang");
+        CHECK(obj.attribs.at("Language") == "english");
+        const auto &tokens = obj.childs.at("Tokens");
+        CHECK(tokens->attribs.at("menu_title") ==
+              "Gr\xC3\xBC\xC3\x9F" "e \xE2\x82\xAC \xF0\x9F\x98\x80 and "
+              "some more ascii text");
+        CHECK(tokens->attribs.at("broken") == "a\xEF\xBF\xBD" "b");
+
+        std::istringstream stream(bytes);
+        CHECK(vdf::read_utf16(stream).childs.at("Tokens")->attribs.size() ==
+              2);
+    }
+
+    // without byte order mark, little endian
+    const std::string bytes = utf16_bytes(u"\"a\" { \"b\" \"c\" }", false);
+    CHECK(vdf::read_utf16(bytes.data() + 2, bytes.data() + bytes.size())
+              .attribs.at("b") == "c");
+
+    const std::string broken = utf16_bytes(u"\"a\" { \"b\" ", false);
+    CHECK_THROWS_AS(
+        vdf::read_utf16(broken.data(), broken.data() + broken.size()),
+        vdf::parse_error);
+}
+
+TEST_CASE("detect encoding")
+{
+    vdf::Options opt;
+    opt.detect_encoding = true;
+    auto read_value = [&opt](const std::string &bytes)
+    {
+        std::istringstream stream(bytes);
+        return vdf::read(stream, opt).attribs.at("k");
+    };
+
+    CHECK(read_value("\"a\" { \"k\" \"Gr\xC3\xBC\xC3\x9F"
+                     "e\" }") == "Gr\xC3\xBC\xC3\x9F"
+                                 "e");
+    CHECK(read_value("\xEF\xBB\xBF\"a\" { \"k\" \"v\" }") == "v");
+    // not valid UTF-8, read as Latin-1
+    CHECK(read_value("\"a\" { \"k\" \"Gr\xFC\xDF"
+                     "e\" }") == "Gr\xC3\xBC\xC3\x9F"
+                                 "e");
+    const std::u16string text = u"\"a\" { \"k\" \"\u20AC\" }";
+    CHECK(read_value(utf16_bytes(text, false)) == "\xE2\x82\xAC");
+    CHECK(read_value(utf16_bytes(text, true)) == "\xE2\x82\xAC");
+    // without byte order mark
+    CHECK(read_value(utf16_bytes(text, false).substr(2)) == "\xE2\x82\xAC");
+    CHECK(read_value(utf16_bytes(text, true).substr(2)) == "\xE2\x82\xAC");
+
+    // a surrogate pair across the blocks of 64 KiB, which are transcoded one
+    // after another
+    const std::u16string prefix = u"\"a\" { \"k\" \"";
+    const size_t filler = 32766 - prefix.size();
+    const std::string bytes = utf16_bytes(
+        prefix + std::u16string(filler, u'x') + u"\U0001F600\" }", false);
+    CHECK(read_value(bytes) == std::string(filler, 'x') + "\xF0\x9F\x98\x80");
+
+    // without detection, the bytes are kept
+    std::istringstream stream("\"a\" { \"k\" \"\xFC\" }");
+    CHECK(vdf::read(stream).attribs.at("k") == "\xFC");
+}
+
+TEST_CASE("utf conversion")
+{
+    // crosses the vectorized ASCII blocks, with 2, 3 and 4 byte characters
+    const std::string utf8 = "plain ascii text of some length \xC3\xBC"
+                             "\xE2\x82\xAC\xF0\x9F\x98\x80 and ascii again, "
+                             "longer than 16 bytes";
+    const std::u16string utf16 = u"plain ascii text of some length \u00FC"
+                                 u"\u20AC\U0001F600 and ascii again, "
+                                 u"longer than 16 bytes";
+    const std::u32string utf32 = U"plain ascii text of some length \u00FC"
+                                 U"\u20AC\U0001F600 and ascii again, "
+                                 U"longer than 16 bytes";
+    const std::wstring wide = L"plain ascii text of some length \u00FC"
+                              L"\u20AC\U0001F600 and ascii again, "
+                              L"longer than 16 bytes";
+    CHECK(vdf::to_utf16(utf8) == utf16);
+    CHECK(vdf::to_utf32(utf8) == utf32);
+    CHECK(vdf::to_wstring(utf8) == wide);
+    CHECK(vdf::to_utf8(utf16) == utf8);
+    CHECK(vdf::to_utf8(utf32) == utf8);
+    CHECK(vdf::to_utf8(wide) == utf8);
+    CHECK(vdf::to_utf8(std::u16string()).empty());
+
+    // truncated, overlong and surrogate sequences and stray continuation
+    // bytes
+    CHECK(vdf::to_utf32("a\xC3") == U"a\uFFFD");
+    CHECK(vdf::to_utf32("\xC0\xAF") == U"\uFFFD\uFFFD");
+    CHECK(vdf::to_utf32("\xED\xA0\x80z") == U"\uFFFD\uFFFD\uFFFDz");
+    CHECK(vdf::to_utf16("\x80") == u"\uFFFD");
+    CHECK(vdf::to_utf8(std::u32string(1, char32_t(0x110000))) ==
+          "\xEF\xBF\xBD");
+    CHECK(vdf::to_utf8(std::u16string(1, char16_t(0xDC00))) ==
+          "\xEF\xBF\xBD");
+}
+
+TEST_CASE("validate utf8")
+{
+    vdf::Options opt;
+    opt.validate_utf8 = true;
+    auto invalid_offset = [&opt](const std::string &text)
+    {
+        std::error_code ec;
+        size_t offset = 0;
+        vdf::read(text.begin(), text.end(), ec, offset, opt);
+        return ec ? offset : text.npos;
+    };
+
+    CHECK(invalid_offset("\"a\" { \"k\" \"Gr\xC3\xBC\xC3\x9F"
+                         "e\" }") == std::string::npos);
+    CHECK(invalid_offset("\"a\" { \"k\" \"Gr\xFC"
+                         "e\" }") == 13);
+    // in keys, comments and truncated at the end
+    CHECK(invalid_offset("\"a\xC0\xAF\" { }") == 2);
+    CHECK(invalid_offset("// \xED\xA0\x80\n\"a\" { }") == 3);
+    CHECK(invalid_offset("\"a\" { } \xE2\x82") == 8);
+
+    // valid and invalid sequences across the validated blocks
+    std::string text = "\"a\" {";
+    while (text.size() < 10000)
+        text += " \"k\" \"\xF0\x9F\x98\x80\"";
+    CHECK(invalid_offset(text + " }") == std::string::npos);
+    CHECK(invalid_offset(text + " \x80 }") == text.size() + 1);
+
+    // sequences at every position around the end of the first block
+    const std::string prefix = "\"a\" { \"k\" \"";
+    const std::pair<std::string, size_t> sequences[] = {
+        {"\xF0\x9F\x98\x80", std::string::npos},
+        {"\xF0\x9F\x98\x80\x80\x80\x80", 4},
+        {"\xFF\x80\x80\x80\x80", 0},
+        {"\xE2\x82\x80\x80\x80\x80", 3},
+        {"\xE2\x82x", 0},
+        {"x\xC3", 1}};
+    for (size_t pos = 4080; pos < 4100; ++pos)
+        for (const auto &seq : sequences)
+        {
+            CAPTURE(pos);
+            CAPTURE(seq.first);
+            const std::string padded =
+                prefix + std::string(pos - prefix.size(), 'x') + seq.first +
+                "\" }";
+            const size_t expected =
+                seq.second == std::string::npos ? seq.second : pos + seq.second;
+            CHECK(invalid_offset(padded) == expected);
+
+            const std::deque<char> chars(padded.begin(), padded.end());
+            std::error_code ec;
+            size_t offset = 0;
+            vdf::read(chars.begin(), chars.end(), ec, offset, opt);
+            CHECK((ec ? offset : std::string::npos) == expected);
+        }
+
+    // iterators which are not contiguous
+    const std::string bad = "\"a\" { \"k\" \"\xC3\x28\" }";
+    const std::deque<char> chars(bad.begin(), bad.end());
+    CHECK_THROWS_AS(vdf::read(chars.begin(), chars.end(), opt),
+                    vdf::parse_error);
+
+    // recovery reports every broken sequence once
+    opt.recover_errors = true;
+    std::vector<vdf::diagnostic> diagnostics;
+    const std::string twice = "\"a\" { \"\xE2\x82\" \"\xFF\xFF\" }";
+    const auto obj = vdf::read(twice.begin(), twice.end(), diagnostics, opt);
+    REQUIRE(diagnostics.size() == 3);
+    CHECK(diagnostics[0].offset == 7);
+    CHECK(diagnostics[1].offset == 12);
+    CHECK(diagnostics[2].offset == 13);
+    CHECK(obj.attribs.empty());
+
+    // only the key/value pairs and objects holding them are skipped
+    diagnostics.clear();
+    const std::string mixed = "\"a\" { \"k\" \"v\xFF\" \"b\xC3\" { \"x\" \"y\" } "
+                              "\"c\" { \"l\" \"w\" } \"m\" \"\xE2\x82\xAC\" }";
+    const auto kept = vdf::read(mixed.begin(), mixed.end(), diagnostics, opt);
+    CHECK(diagnostics.size() == 2);
+    CHECK(kept.attribs.size() == 1);
+    CHECK(kept.attribs.at("m") == "\xE2\x82\xAC");
+    REQUIRE(kept.childs.size() == 1);
+    CHECK(kept.childs.at("c")->attribs.at("l") == "w");
+}
+
 TEST_CASE("issue14")
 {
     std::ifstream input_file("issue14.vdf", std::ios::in);
@@ -245,6 +567,30 @@ TEST_CASE_TEMPLATE("Write escaped", charT, char, wchar_t)
     }
 }
 
+TEST_CASE_TEMPLATE("append escaped", charT, char, wchar_t)
+{
+    // cover the vectorized blocks and the scalar tail at every position
+    for (size_t size = 0; size < 40; ++size)
+        for (size_t pos = 0; pos < size; ++pos)
+        {
+            CAPTURE(size);
+            CAPTURE(pos);
+            std::basic_string<charT> in(size, TYTI_L(charT, 'a'));
+            in[pos] = pos % 2 ? TYTI_L(charT, '"') : TYTI_L(charT, '\\');
+            std::basic_string<charT> expected = in;
+            expected.insert(pos, 1, TYTI_L(charT, '\\'));
+
+            std::basic_string<charT> out(TYTI_L(charT, "x"));
+            vdf::detail::append_escaped(out, in);
+            CHECK(out == TYTI_L(charT, "x") + expected);
+        }
+
+    std::basic_string<charT> out;
+    vdf::detail::append_escaped(
+        out, std::basic_string<charT>(TYTI_L(charT, "\"\\\"")));
+    CHECK(out == TYTI_L(charT, "\\\"\\\\\\\""));
+}
+
 TEST_CASE_TEMPLATE("write not-escaped", charT, char, wchar_t)
 {
 
@@ -275,6 +621,310 @@ TEST_CASE_TEMPLATE("write not-escaped", charT, char, wchar_t)
     }
 }
 
+TEST_CASE_TEMPLATE("write to string", charT, char, wchar_t)
+{
+    std::basic_ifstream<charT> file("DST_Manifest.acf");
+    const auto obj = vdf::read(file);
+
+    std::basic_stringstream<charT> stream;
+    vdf::write(stream, obj);
+
+    std::basic_string<charT> str(TYTI_L(charT, "prefix"));
+    vdf::write(str, obj);
+    CHECK(str == TYTI_L(charT, "prefix") + stream.str());
+
+    const auto test_obj = vdf::read(str.begin() + 6, str.end());
+    CHECK(test_obj.attribs == obj.attribs);
+    CHECK(test_obj.childs.size() == obj.childs.size());
+}
+
+TEST_CASE("write large tree in blocks")
+{
+    // larger than the internal buffer, so the stream receives several blocks
+    vdf::object obj;
+    obj.name = "root";
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto child = std::make_unique<vdf::object>();
+        child->name = "child" + std::to_string(i);
+        for (int j = 0; j < 10; ++j)
+            child->attribs["key" + std::to_string(j)] = std::string(10, 'x');
+        obj.add_child(std::move(child));
+    }
+
+    std::stringstream stream;
+    vdf::write(stream, obj);
+    std::string str;
+    vdf::write(str, obj);
+    CHECK(str.size() > vdf::detail::write_block_size);
+    CHECK(stream.str() == str);
+
+    const auto test_obj = vdf::read(stream);
+    CHECK(test_obj.childs.size() == 1000);
+}
+
+TEST_CASE_TEMPLATE("write compact", charT, char, wchar_t)
+{
+    std::basic_ifstream<charT> file("DST_Manifest.acf");
+    const auto obj = vdf::read(file);
+
+    vdf::WriteOptions opts;
+    opts.compact = true;
+    std::basic_string<charT> compact;
+    vdf::write(compact, obj, opts);
+    std::basic_string<charT> pretty;
+    vdf::write(pretty, obj);
+    CHECK(compact.size() < pretty.size());
+    CHECK(compact.find(TYTI_L(charT, '\n')) == compact.npos);
+
+    const auto test_obj = vdf::read(compact.begin(), compact.end());
+    CHECK(test_obj.name == obj.name);
+    CHECK(test_obj.attribs == obj.attribs);
+    const auto &app = *obj.childs.at(TYTI_L(charT, "AppState"));
+    const auto &test_app = *test_obj.childs.at(TYTI_L(charT, "AppState"));
+    CHECK(test_app.attribs == app.attribs);
+    CHECK(test_app.childs.size() == app.childs.size());
+}
+
+TEST_CASE("write compact tokens")
+{
+    vdf::object obj;
+    obj.name = "root";
+    obj.attribs["plain"] = "123";
+    obj.attribs[""] = "empty key";
+    obj.attribs["empty"] = "";
+    obj.attribs["//comment"] = "/value";
+    obj.attribs["[cond]"] = "[$WIN32]";
+    obj.attribs["quote\"d"] = "back\\slash";
+    obj.attribs["{"] = "}";
+    obj.attribs["tab\t"] = "new\nline";
+    auto child = std::make_unique<vdf::object>();
+    child->name = "child node";
+    child->attribs["key"] = "value";
+    obj.add_child(std::move(child));
+    obj.add_child(std::make_unique<vdf::object>());
+
+    vdf::WriteOptions opts;
+    opts.compact = true;
+    std::string str;
+    vdf::write(str, obj, opts);
+    CAPTURE(str);
+    CHECK(str.find("root {") == 0);
+    CHECK(str.find("plain 123 ") != str.npos);
+
+    const auto test_obj = vdf::read(str.begin(), str.end());
+    CHECK(test_obj.name == obj.name);
+    CHECK(test_obj.attribs == obj.attribs);
+    REQUIRE(test_obj.childs.size() == 2);
+    CHECK(test_obj.childs.at("child node")->attribs.at("key") == "value");
+    CHECK(test_obj.childs.at("")->attribs.empty());
+}
+
+TEST_CASE_TEMPLATE("streaming writer", charT, char, wchar_t)
+{
+    for (const bool compact : {false, true})
+    {
+        CAPTURE(compact);
+        vdf::WriteOptions opts;
+        opts.compact = compact;
+
+        vdf::basic_object<charT> obj;
+        obj.name = TYTI_L(charT, "root");
+        obj.attribs[TYTI_L(charT, "key")] = TYTI_L(charT, "\"value\"");
+        auto child = std::make_unique<vdf::basic_object<charT>>();
+        child->name = TYTI_L(charT, "child");
+        child->attribs[TYTI_L(charT, "a b")] = TYTI_L(charT, "c");
+        obj.add_child(std::move(child));
+
+        std::basic_stringstream<charT> tree_output;
+        vdf::write(tree_output, obj, opts);
+
+        std::basic_stringstream<charT> output;
+        {
+            vdf::basic_writer<std::basic_ostream<charT>> w(output, opts);
+            w.begin_object(TYTI_L(charT, "root"));
+            w.key_value(TYTI_L(charT, "key"), TYTI_L(charT, "\"value\""));
+            w.begin_object(TYTI_L(charT, "child"))
+                .key_value(TYTI_L(charT, "a b"), TYTI_L(charT, "c"))
+                .end_object();
+            CHECK(w.depth() == 1);
+            w.end_object();
+            CHECK(w.depth() == 0);
+        }
+        CHECK(output.str() == tree_output.str());
+    }
+}
+
+TEST_CASE("streaming writer large output")
+{
+    std::stringstream output;
+    vdf::writer w(output);
+    w.begin_object("root");
+    for (int i = 0; i < 10000; ++i)
+    {
+        w.begin_object("record" + std::to_string(i));
+        w.key_value("id", std::to_string(i));
+        w.end_object();
+    }
+    w.end_object();
+    w.flush();
+
+    const auto obj = vdf::read(output);
+    CHECK(obj.childs.size() == 10000);
+    CHECK(obj.childs.at("record42")->attribs.at("id") == "42");
+}
+
+TEST_CASE("streaming writer misuse")
+{
+    std::stringstream output;
+    vdf::writer w(output);
+    CHECK_THROWS_AS(w.key_value("key", "value"), std::logic_error);
+    CHECK_THROWS_AS(w.end_object(), std::logic_error);
+    w.begin_object("root");
+    w.end_object();
+    CHECK_THROWS_AS(w.end_object(), std::logic_error);
+}
+
+namespace
+{
+/// chain of nested objects, each with one attribute
+vdf::object deep_chain(size_t depth)
+{
+    vdf::object root;
+    root.name = "level0";
+    vdf::object *cur = &root;
+    for (size_t i = 1; i < depth; ++i)
+    {
+        cur->attribs["depth"] = std::to_string(i - 1);
+        auto child = std::make_shared<vdf::object>();
+        child->name = "level" + std::to_string(i);
+        cur->childs.emplace(child->name, child);
+        cur = child.get();
+    }
+    return root;
+}
+
+size_t chain_depth(const vdf::object &root)
+{
+    size_t depth = 1;
+    for (const vdf::object *cur = &root; !cur->childs.empty();
+         cur = cur->childs.begin()->second.get())
+        ++depth;
+    return depth;
+}
+
+/// destroys the chain without recursing through the destructors
+void dismantle(vdf::object &root)
+{
+    auto childs = std::move(root.childs);
+    while (!childs.empty())
+    {
+        auto next = std::move(childs.begin()->second->childs);
+        childs = std::move(next);
+    }
+}
+} // namespace
+
+TEST_CASE("write deep trees")
+{
+    // deep enough to overflow the call stack of a recursive writer
+    const size_t depth = 200000;
+    auto obj = deep_chain(depth);
+
+    vdf::WriteOptions opts;
+    opts.compact = true;
+    std::string str;
+    vdf::write(str, obj, opts);
+    auto test_obj = vdf::read(str.begin(), str.end());
+    CHECK(chain_depth(test_obj) == depth);
+    dismantle(test_obj);
+
+    std::stringstream stream;
+    vdf::write(stream, obj, opts);
+    CHECK(stream.str() == str);
+
+    // the indentation grows quadratically, keep the pretty output smaller
+    auto pretty_obj = deep_chain(2000);
+    str.clear();
+    vdf::write(str, pretty_obj);
+    test_obj = vdf::read(str.begin(), str.end());
+    CHECK(chain_depth(test_obj) == 2000);
+    CHECK(str.find(std::string(1999, '\t') + "}\n") != str.npos);
+    dismantle(test_obj);
+    dismantle(pretty_obj);
+    dismantle(obj);
+}
+
+TEST_CASE_TEMPLATE("subtree hashes", charT, char, wchar_t)
+{
+    using string = std::basic_string<charT>;
+    vdf::Options opt;
+    opt.compute_hashes = true;
+    auto parse = [&](const string &s)
+    { return vdf::read(s.begin(), s.end(), opt); };
+
+    const auto a = parse(T_L("\"r\" { \"a\" \"1\" \"b\" \"2\" "
+                             "\"c\" { \"x\" \"y\" } \"d\" { } }"));
+    const auto b = parse(T_L("\"r\" { \"d\" { } \"b\" \"2\" "
+                             "\"c\" { \"x\" \"y\" } \"a\" \"1\" }"));
+    const auto c = parse(T_L("\"r\" { \"a\" \"1\" \"b\" \"2\" "
+                             "\"c\" { \"x\" \"z\" } \"d\" { } }"));
+    CHECK(a.hash != 0);
+    CHECK(a.hash == b.hash);
+    CHECK(a.hash != c.hash);
+    CHECK(a.childs.at(T_L("d"))->hash == c.childs.at(T_L("d"))->hash);
+    CHECK(a.childs.at(T_L("c"))->hash != c.childs.at(T_L("c"))->hash);
+
+    // attributes and childs, keys and values, and names are distinguished
+    CHECK(parse(T_L("\"r\" { \"a\" \"b\" }")).hash !=
+          parse(T_L("\"r\" { \"b\" \"a\" }")).hash);
+    CHECK(parse(T_L("\"r\" { \"a\" { } }")).hash !=
+          parse(T_L("\"r\" { \"a\" \"\" }")).hash);
+    CHECK(parse(T_L("\"r\" { }")).hash != parse(T_L("\"s\" { }")).hash);
+
+    // several roots
+    const string roots = T_L("\"a\" { } \"b\" { }");
+    CHECK(parse(roots).hash != 0);
+    CHECK(vdf::read(roots.begin(), roots.end()).hash == 0);
+
+    // modified trees are hashed again by update_hashes
+    auto modified = a;
+    modified.childs[T_L("c")] = std::make_shared<vdf::basic_object<charT>>(
+        *a.childs.at(T_L("c")));
+    modified.childs[T_L("c")]->attribs[T_L("x")] = T_L("z");
+    vdf::update_hashes(modified);
+    CHECK(modified.hash == c.hash);
+
+    // multikey objects keep the order of values with the same key
+    auto parse_multi = [&](const string &s)
+    { return vdf::read<vdf::basic_multikey_object<charT>>(s.begin(), s.end(),
+                                                          opt); };
+    const auto m = parse_multi(T_L("\"r\" { \"k\" \"1\" \"j\" \"0\" "
+                                   "\"k\" \"2\" }"));
+    CHECK(m.hash == parse_multi(T_L("\"r\" { \"j\" \"0\" \"k\" \"1\" "
+                                    "\"k\" \"2\" }"))
+                        .hash);
+    CHECK(m.hash != parse_multi(T_L("\"r\" { \"k\" \"2\" \"j\" \"0\" "
+                                    "\"k\" \"1\" }"))
+                        .hash);
+}
+
+TEST_CASE("hashes of custom types")
+{
+    // output types without a hash member are not hashed
+    struct named
+    {
+        std::string name;
+        void add_attribute(std::string, std::string) {}
+        void add_child(std::unique_ptr<named>) {}
+        void set_name(std::string n) { name = std::move(n); }
+    };
+    vdf::Options opt;
+    opt.compute_hashes = true;
+    const std::string s = "\"r\" { \"a\" { } }";
+    CHECK(vdf::read<named>(s.begin(), s.end(), opt).name == "r");
+}
+
 /////////////////////////////////////////////////////////////
 // readme test
 /////////////////////////////////////////////////////////////
@@ -311,6 +961,16 @@ TEST_CASE("fuzzing_files")
         {
             std::ifstream f(dir_entry.path().string());
             CHECK_THROWS(tyti::vdf::read(f));
+
+            f.clear();
+            f.seekg(0);
+            const std::string text((std::istreambuf_iterator<char>(f)),
+                                   std::istreambuf_iterator<char>());
+            tyti::vdf::Options opt;
+            opt.recover_errors = true;
+            std::vector<tyti::vdf::diagnostic> diagnostics;
+            tyti::vdf::read(text.begin(), text.end(), diagnostics, opt);
+            CHECK(!diagnostics.empty());
         }
     }
 }
\ No newline at end of file
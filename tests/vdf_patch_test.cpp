@@ -0,0 +1,132 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <vdf_patch.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+std::string read_all(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+} // namespace
+
+TEST_CASE("find value")
+{
+    const std::string data = read_all("DST_Manifest.acf");
+    const char *first = data.data();
+    const char *last = first + data.size();
+
+    vdf::value_location loc;
+    REQUIRE(vdf::find_value(first, last, {"AppState", "buildid"}, loc));
+    CHECK(loc.quoted);
+    CHECK(data.substr(loc.begin, loc.end - loc.begin) == "1101428");
+
+    REQUIRE(vdf::find_value(first, last,
+                            {"AppState", "MountedDepots", "343051"}, loc));
+    CHECK(data.substr(loc.begin, loc.end - loc.begin) ==
+          "8201905585059905072");
+
+    REQUIRE(vdf::find_value(first, last,
+                            {"AppState", "no_quoted_attrib_support"}, loc));
+    CHECK(!loc.quoted);
+    CHECK(data.substr(loc.begin, loc.end - loc.begin) == "yes");
+
+    // keys are compared after stripping escape symbols
+    REQUIRE(vdf::find_value(first, last, {"AppState", "escape_quote"}, loc));
+    CHECK(data.substr(loc.begin, loc.end - loc.begin) == "\\\"quote\\\"");
+
+    CHECK(!vdf::find_value(first, last, {"AppState", "does not exist"}, loc));
+    CHECK(!vdf::find_value(first, last, {"MountedDepots", "343051"}, loc));
+    CHECK(!vdf::find_value(first, last, {"AppState", "UserConfig"}, loc));
+    CHECK(!vdf::find_value(first, last, {"buildid"}, loc));
+}
+
+TEST_CASE("patch value in buffer")
+{
+    std::string data = read_all("DST_Manifest.acf");
+    const std::string original = data;
+
+    CHECK(vdf::patch_value(data, {"AppState", "buildid"}, "42"));
+    CHECK(vdf::patch_value(data, {"AppState", "StateFlags"}, "with \"quote\""));
+    CHECK(vdf::patch_value(data, {"AppState", "no_quoted_attrib_support"},
+                           "needs quotes"));
+    CHECK(!vdf::patch_value(data, {"AppState", "nope"}, "1"));
+
+    // comments and the remaining text are untouched
+    CHECK(data.find("// comment with a \"quote\"") != data.npos);
+    CHECK(data.size() == original.size() - 7 + 2 - 1 + 14 - 3 + 14);
+
+    const auto obj = vdf::read(data.begin(), data.end());
+    const auto &app = *obj.childs.at("AppState");
+    CHECK(app.attribs.at("buildid") == "42");
+    CHECK(app.attribs.at("StateFlags") == "with \"quote\"");
+    CHECK(app.attribs.at("no_quoted_attrib_support") == "needs quotes");
+    CHECK(app.attribs.at("appid") == "343050");
+
+    std::wstring wdata = L"\"a\" { \"b\" { \"c\" \"1\" } \"c\" \"2\" }";
+    CHECK(vdf::patch_value(wdata, {L"a", L"c"}, L"3"));
+    CHECK(wdata == L"\"a\" { \"b\" { \"c\" \"1\" } \"c\" \"3\" }");
+}
+
+TEST_CASE("patch value with conditionals")
+{
+    // $WIN32 stands for all pc platforms
+    const std::string text =
+        "\"root\" { \"key\" \"a\" [!$WIN32] \"key\" \"b\" [$WIN32] }";
+    std::string data = text;
+    CHECK(vdf::read(data.begin(), data.end()).attribs.at("key") == "b");
+    CHECK(vdf::patch_value(data, {"root", "key"}, "c"));
+    CHECK(vdf::read(data.begin(), data.end()).attribs.at("key") == "c");
+    CHECK(data.find("\"a\"") != data.npos);
+
+    vdf::Options opt;
+    opt.ignore_all_platform_conditionals = true;
+    data = text;
+    CHECK(vdf::patch_value(data, {"root", "key"}, "c", opt));
+    CHECK(vdf::read(data.begin(), data.end(), opt).attribs.at("key") == "c");
+    CHECK(data.find("\"b\"") != data.npos);
+}
+
+TEST_CASE("patch file")
+{
+    const auto path =
+        std::filesystem::temp_directory_path() / "vdf_test_patch.acf";
+    const std::string data = "// header\n\"AppState\"\n{\n"
+                             "\t\"buildid\"\t\t\"100\"\n"
+                             "\t\"name\"\t\t\"game\"\n}\n";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << data;
+    }
+
+    // same length, overwritten in place
+    CHECK(vdf::patch_file(path.string(), {"AppState", "buildid"}, "200"));
+    std::string expected = data;
+    CHECK(vdf::patch_value(expected, {"AppState", "buildid"}, "200"));
+    CHECK(read_all(path.string()) == expected);
+
+    // longer and shorter values move the rest of the file
+    CHECK(vdf::patch_file(path.string(), {"AppState", "buildid"}, "123456"));
+    CHECK(vdf::patch_value(expected, {"AppState", "buildid"}, "123456"));
+    CHECK(read_all(path.string()) == expected);
+
+    CHECK(vdf::patch_file(path.string(), {"AppState", "name"}, ""));
+    CHECK(vdf::patch_value(expected, {"AppState", "name"}, ""));
+    CHECK(read_all(path.string()) == expected);
+
+    CHECK(!vdf::patch_file(path.string(), {"AppState", "missing"}, "1"));
+    CHECK(read_all(path.string()) == expected);
+
+    std::filesystem::remove(path);
+    CHECK_THROWS_AS(vdf::patch_file(path.string(), {"AppState", "name"}, "1"),
+                    std::system_error);
+}
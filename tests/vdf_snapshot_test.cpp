@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <vdf_snapshot.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+TEST_CASE("snapshot queries")
+{
+    std::ifstream file("DST_Manifest.acf");
+    const auto obj = vdf::read(file);
+    const auto &app = *obj.childs.at("AppState");
+
+    std::string data;
+    vdf::write_snapshot(data, obj);
+    const vdf::snapshot snap(data);
+
+    const auto root = snap.root();
+    REQUIRE(root);
+    CHECK(root.name() == "");
+    const auto app_node = root.child("AppState");
+    REQUIRE(app_node);
+    CHECK(app_node.name() == "AppState");
+    CHECK(app_node.attribute_count() == app.attribs.size());
+    CHECK(app_node.child_count() == app.childs.size());
+
+    CHECK(app_node.attribute("appid") == "343050");
+    CHECK(std::string(app_node.attribute("buildid").c_str()) == "1101428");
+    CHECK(app_node.attribute("emptyAttrib"));
+    CHECK(app_node.attribute("emptyAttrib").size == 0);
+    CHECK(!app_node.attribute("does not exist"));
+    CHECK(!app_node.child("does not exist"));
+
+    // keys are sorted
+    for (size_t i = 1; i < app_node.attribute_count(); ++i)
+        CHECK(app_node.attribute_key(i - 1).str() <
+              app_node.attribute_key(i).str());
+
+    const auto base = app_node.child("BaseInclude");
+    REQUIRE(base);
+    CHECK(base.attribute("BaseAttrib") == "Yes");
+
+    const auto back = root.to_object();
+    const auto &app_back = *back.childs.at("AppState");
+    CHECK(app_back.attribs == app.attribs);
+    CHECK(app_back.childs.size() == app.childs.size());
+}
+
+TEST_CASE("snapshot multikey")
+{
+    std::ifstream file("DST_Manifest.acf");
+    const auto obj = vdf::read<vdf::multikey_object>(file);
+
+    std::string data;
+    vdf::write_snapshot(data, obj);
+    const vdf::snapshot snap(data);
+
+    const auto app = snap.root().child("AppState");
+    const auto range = app.attribute_range("UpdateResult");
+    CHECK(range.second - range.first == 2);
+
+    const auto back = snap.root().to_object<vdf::multikey_object>();
+    CHECK(back.childs.find("AppState")->second->attribs.count("UpdateResult") ==
+          2);
+}
+
+TEST_CASE("snapshot file")
+{
+    vdf::object obj;
+    obj.name = "root";
+    obj.attribs["key"] = "value";
+
+    const auto path =
+        std::filesystem::temp_directory_path() / "vdf_test_snapshot.bin";
+    vdf::save_snapshot(obj, path.string());
+    {
+        const auto snap = vdf::open_snapshot(path.string());
+        CHECK(snap.root().name() == "root");
+        CHECK(snap.root().attribute("key") == "value");
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("snapshot errors")
+{
+    CHECK_THROWS_AS(vdf::snapshot(std::string("no snapshot")),
+                    std::runtime_error);
+
+    vdf::object obj;
+    obj.name = "root";
+    obj.attribs["key"] = "value";
+    std::string data;
+    vdf::write_snapshot(data, obj);
+    CHECK_THROWS_AS(vdf::snapshot(data.substr(0, data.size() - 1)),
+                    std::runtime_error);
+
+    // point the root node behind the end of the data
+    std::string broken = data;
+    broken[16] = static_cast<char>(0xFF);
+    const vdf::snapshot snap(broken);
+    CHECK_THROWS_AS(snap.root(), std::runtime_error);
+
+    // strings without a null terminator behind them
+    const vdf::snapshot valid(data);
+    const size_t terminator = static_cast<size_t>(
+        valid.root().name().data - valid.data()) + 4;
+    REQUIRE(data[terminator] == '\0');
+    broken = data;
+    broken[terminator] = 'x';
+    const vdf::snapshot unterminated(broken);
+    CHECK_THROWS_AS(unterminated.root().name(), std::runtime_error);
+    broken = data;
+    broken[static_cast<size_t>(vdf::detail::load_le64(data.data() + 16)) + 8] =
+        3;
+    const vdf::snapshot shortened(broken);
+    CHECK_THROWS_AS(shortened.root().name(), std::runtime_error);
+}
+
+TEST_CASE("snapshot with a cycle")
+{
+    vdf::object obj;
+    obj.name = "root";
+    obj.add_child(std::make_unique<vdf::object>());
+    std::string data;
+    vdf::write_snapshot(data, obj);
+
+    // let the child entry refer to the root node
+    auto load = [&data](size_t pos)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < 8; ++i)
+            v |= uint64_t(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        return static_cast<size_t>(v);
+    };
+    const size_t root = load(16);
+    const size_t child_entry = load(root + 40);
+    std::copy(data.begin() + 16, data.begin() + 24,
+              data.begin() + static_cast<std::ptrdiff_t>(child_entry + 16));
+
+    const vdf::snapshot snap(data);
+    CHECK(snap.root().child(0).name() == "root");
+    CHECK_THROWS_AS(snap.root().to_object(), std::runtime_error);
+}
@@ -0,0 +1,175 @@
+#ifdef __linux__
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vdf_watcher.hpp>
+using namespace tyti;
+
+#include "doctest.h"
+
+namespace
+{
+void write_file(const std::filesystem::path &path, const std::string &data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+}
+
+/// collects the callbacks of a watcher
+struct recorder
+{
+    struct event
+    {
+        std::string path;
+        std::shared_ptr<const vdf::object> tree;
+        std::error_code ec;
+    };
+
+    void operator()(const std::string &path,
+                    const std::shared_ptr<const vdf::object> &tree,
+                    const std::error_code &ec)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(event{path, tree, ec});
+        cv.notify_all();
+    }
+
+    /// waits until n events were recorded
+    bool wait(size_t n)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(10),
+                           [&] { return events.size() >= n; });
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events.size();
+    }
+
+    event at(size_t i)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events.at(i);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<event> events;
+};
+} // namespace
+
+TEST_CASE("file watcher")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_watcher";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "file.vdf";
+    const std::string key = std::filesystem::canonical(dir) / "file.vdf";
+    write_file(path, "\"root\" { \"key\" \"1\" }");
+    write_file(dir / "notes.txt", "not watched");
+
+    recorder rec;
+    vdf::WatchOptions wopt;
+    wopt.debounce = std::chrono::milliseconds(100);
+    vdf::file_watcher watcher(std::ref(rec), vdf::Options{}, wopt);
+    watcher.watch(dir.string());
+
+    // initial parse
+    REQUIRE(rec.wait(1));
+    CHECK(rec.at(0).path == key);
+    CHECK(rec.at(0).tree->attribs.at("key") == "1");
+    CHECK(watcher.get(path.string()) == rec.at(0).tree);
+
+    // a burst of writes is parsed once
+    for (int i = 2; i <= 5; ++i)
+        write_file(path, "\"root\" { \"key\" \"" + std::to_string(i) + "\" }");
+    write_file(dir / "notes.txt", "still not watched");
+    REQUIRE(rec.wait(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(rec.size() == 2);
+    CHECK(rec.at(1).tree->attribs.at("key") == "5");
+    CHECK(watcher.get(path.string())->attribs.at("key") == "5");
+
+    // parse errors keep the last tree
+    write_file(path, "\"root\" { \"key\" ");
+    REQUIRE(rec.wait(3));
+    CHECK(!rec.at(2).tree);
+    CHECK(rec.at(2).ec == std::errc::protocol_error);
+    CHECK(watcher.get(path.string())->attribs.at("key") == "5");
+
+    // files replaced via rename
+    write_file(dir / "file.tmp", "\"root\" { \"key\" \"6\" }");
+    std::filesystem::rename(dir / "file.tmp", path);
+    REQUIRE(rec.wait(4));
+    CHECK(rec.at(3).tree->attribs.at("key") == "6");
+
+    std::filesystem::remove(path);
+    REQUIRE(rec.wait(5));
+    CHECK(!rec.at(4).tree);
+    CHECK(rec.at(4).ec == std::errc::no_such_file_or_directory);
+    CHECK(!watcher.get(path.string()));
+
+    // single files, which are created later
+    const auto other = dir / "sub" / "single.txt";
+    std::filesystem::create_directories(other.parent_path());
+    watcher.watch(other.string());
+    write_file(other, "\"other\" { }");
+    REQUIRE(rec.wait(6));
+    CHECK(rec.at(5).tree->name == "other");
+
+    CHECK_THROWS_AS(watcher.watch((dir / "missing" / "a.vdf").string()),
+                    std::system_error);
+    CHECK(!watcher.error());
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("file watcher errors")
+{
+    const auto dir =
+        std::filesystem::temp_directory_path() / "vdf_test_watcher_errors";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "file.vdf";
+    write_file(path, "\"root\" { }");
+
+    recorder rec;
+    vdf::file_watcher watcher(std::ref(rec));
+    watcher.watch(dir.string());
+    REQUIRE(rec.wait(1));
+
+    // replace the inotify descriptor of the watcher by the write end of a
+    // pipe without reader, which fails to poll and to read
+    int inotify = -1;
+    for (const auto &f : std::filesystem::directory_iterator("/proc/self/fd"))
+    {
+        std::error_code ec;
+        if (std::filesystem::read_symlink(f.path(), ec) ==
+            "anon_inode:inotify")
+            inotify = std::stoi(f.path().filename().string());
+    }
+    REQUIRE(inotify >= 0);
+    int fds[2];
+    REQUIRE(::pipe(fds) == 0);
+    ::close(fds[0]);
+    ::dup2(fds[1], inotify);
+    ::close(fds[1]);
+    write_file(path, "\"root\" { \"key\" \"1\" }");
+
+    REQUIRE(rec.wait(2));
+    CHECK(rec.at(1).path.empty());
+    CHECK(!rec.at(1).tree);
+    CHECK(rec.at(1).ec);
+    CHECK(watcher.error() == rec.at(1).ec);
+    std::filesystem::remove_all(dir);
+}
+
+#endif